@@ -0,0 +1,366 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A render backend writing ANSI sequences to the terminal
+
+#include <curses.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ansi_display.h"
+#include "display.h"
+#include "worm.h"
+
+#define INITIAL_OUTPUT_CAPACITY 4096
+#define UNKNOWN_ATTR ((chtype)-1) // The attributes of the terminal are unknown
+#define BLANK_CELL ((chtype)' ')  // A cleared cell
+
+static struct {
+  int nrows;
+  int ncols;
+  chtype* front;   // What the terminal shows
+  chtype* back;    // What the next frame shall show
+  int* dirty_min;  // Per row: first column written since the last frame
+  int* dirty_max;  // Per row: last column written; < dirty_min: none
+  char* out;       // The ANSI sequences of the frame
+  size_t out_size;
+  size_t out_capacity;
+  int cur_y;       // Position of the cursor; cur_y < 0: unknown
+  int cur_x;
+  chtype cur_attr; // Attributes in effect on the terminal
+  short pair_fg[ANSI_MAX_PAIRS]; // Colors of the curses pairs; -1: default
+  short pair_bg[ANSI_MAX_PAIRS];
+  struct render_stats stats;
+} ansi;
+
+// ************************************
+// Building the output
+// ************************************
+
+// Append len bytes to the output of the frame
+static void emit(const char* data, size_t len) {
+  if (ansi.out_size + len > ansi.out_capacity) {
+    size_t capacity = 2 * ansi.out_capacity;
+    char* out;
+
+    while (capacity < ansi.out_size + len) {
+      capacity *= 2;
+    }
+    out = realloc(ansi.out, capacity);
+    if (out == NULL) {
+      return; // Out of memory: the terminal misses some cells
+    }
+    ansi.out = out;
+    ansi.out_capacity = capacity;
+  }
+  memcpy(ansi.out + ansi.out_size, data, len);
+  ansi.out_size += len;
+}
+
+// Number of decimal digits of n > 0
+static int digits(int n) {
+  int count = 1;
+  while (n >= 10) {
+    n /= 10;
+    count++;
+  }
+  return count;
+}
+
+// One color in an SGR sequence; base is 30 (foreground) or 40 (background)
+static int formatColor(char* text, size_t size, short color, int base) {
+  if (color < 0) {
+    return snprintf(text, size, ";%d", base + 9); // Default color
+  } else if (color < 8) {
+    return snprintf(text, size, ";%d", base + color);
+  }
+  return snprintf(text, size, ";%d;5;%d", base + 8, color);
+}
+
+// Switch the terminal to the attributes (including the color pair) of attr
+static void setAttributes(chtype attr) {
+  char text[64];
+  int len;
+  short pair = PAIR_NUMBER(attr);
+
+  if (attr == ansi.cur_attr) {
+    return;
+  }
+  // Start from a reset; then only the attributes set are listed
+  len = snprintf(text, sizeof(text), "\033[0");
+  if (attr & A_BOLD) {
+    len += snprintf(text + len, sizeof(text) - len, ";1");
+  }
+  if (attr & A_DIM) {
+    len += snprintf(text + len, sizeof(text) - len, ";2");
+  }
+  if (attr & A_UNDERLINE) {
+    len += snprintf(text + len, sizeof(text) - len, ";4");
+  }
+  if (attr & A_BLINK) {
+    len += snprintf(text + len, sizeof(text) - len, ";5");
+  }
+  if (attr & A_REVERSE) {
+    len += snprintf(text + len, sizeof(text) - len, ";7");
+  }
+  if (pair > 0 && pair < ANSI_MAX_PAIRS &&
+      (ansi.pair_fg[pair] >= 0 || ansi.pair_bg[pair] >= 0)) {
+    len += formatColor(text + len, sizeof(text) - len, ansi.pair_fg[pair], 30);
+    len += formatColor(text + len, sizeof(text) - len, ansi.pair_bg[pair], 40);
+  }
+  len += snprintf(text + len, sizeof(text) - len, "m");
+  emit(text, len);
+  ansi.cur_attr = attr;
+}
+
+// Write the cell c at the cursor position
+static void putCell(chtype c) {
+  char ch = (char)(c & A_CHARTEXT);
+
+  if ((c & A_CHARTEXT) < ' ' || (c & A_CHARTEXT) > '~') {
+    ch = '?'; // We only send plain ASCII
+  }
+  setAttributes(c & A_ATTRIBUTES);
+  emit(&ch, 1);
+  if (++ansi.cur_x == ansi.ncols) {
+    ansi.cur_y = -1; // The terminal may have wrapped or not
+  }
+}
+
+// Move the cursor to (y,x) by the shortest sequence:
+// rewriting a few unchanged cells, moving forward or moving absolutely
+static void moveCursor(int y, int x) {
+  char text[32];
+  int absolute = 4 + digits(y + 1) + digits(x + 1);
+  int gap;
+
+  if (ansi.cur_y == y && ansi.cur_x == x) {
+    return;
+  }
+  if (ansi.cur_y == y && ansi.cur_x < x) {
+    chtype* row = &ansi.front[y * ansi.ncols];
+    int forward;
+    int i;
+
+    gap = x - ansi.cur_x;
+    // Cells between are unchanged; if they have the current attributes,
+    // sending them again is cheapest
+    if (gap <= ANSI_MAX_REWRITE) {
+      for (i = ansi.cur_x; i < x; i++) {
+        if ((row[i] & A_ATTRIBUTES) != ansi.cur_attr) {
+          break;
+        }
+      }
+      if (i == x) {
+        for (i = ansi.cur_x; i < x; i++) {
+          putCell(row[i]);
+        }
+        return;
+      }
+    }
+    forward = gap == 1 ? 3 : 3 + digits(gap);
+    if (forward < absolute) {
+      emit(text, gap == 1 ? snprintf(text, sizeof(text), "\033[C")
+                          : snprintf(text, sizeof(text), "\033[%dC", gap));
+      ansi.cur_x = x;
+      return;
+    }
+  }
+  emit(text, snprintf(text, sizeof(text), "\033[%d;%dH", y + 1, x + 1));
+  ansi.cur_y = y;
+  ansi.cur_x = x;
+}
+
+// Send the output of the frame to the terminal
+static void writeOutput(void) {
+  size_t done = 0;
+
+  while (done < ansi.out_size) {
+    ssize_t n = write(STDOUT_FILENO, ansi.out + done, ansi.out_size - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break; // The terminal is gone; nothing we can do
+    }
+    done += n;
+    ansi.stats.writes++;
+  }
+  ansi.stats.bytes += done;
+  ansi.out_size = 0;
+}
+
+// ************************************
+// The backend
+// ************************************
+
+static void cleanupAnsiBackend(void);
+
+static enum ResCodes initializeAnsiBackend(void) {
+  long ncells = (long)LINES * COLS;
+  short pair;
+  long i;
+
+  memset(&ansi, 0, sizeof(ansi));
+  ansi.nrows = LINES;
+  ansi.ncols = COLS;
+  ansi.front = malloc(ncells * sizeof(chtype));
+  ansi.back = malloc(ncells * sizeof(chtype));
+  ansi.dirty_min = malloc(LINES * sizeof(int));
+  ansi.dirty_max = malloc(LINES * sizeof(int));
+  ansi.out = malloc(INITIAL_OUTPUT_CAPACITY);
+  if (ansi.front == NULL || ansi.back == NULL || ansi.dirty_min == NULL ||
+      ansi.dirty_max == NULL || ansi.out == NULL) {
+    cleanupAnsiBackend();
+    return RES_FAILED;
+  }
+  ansi.out_capacity = INITIAL_OUTPUT_CAPACITY;
+  for (i = 0; i < ncells; i++) {
+    ansi.front[i] = ansi.back[i] = BLANK_CELL;
+  }
+  for (i = 0; i < ansi.nrows; i++) {
+    ansi.dirty_min[i] = ansi.ncols;
+    ansi.dirty_max[i] = -1;
+  }
+  ansi.cur_y = -1;
+  ansi.cur_attr = UNKNOWN_ATTR;
+
+  // Use the colors curses would use; without start_color there are none
+  for (pair = 0; pair < ANSI_MAX_PAIRS; pair++) {
+    ansi.pair_fg[pair] = ansi.pair_bg[pair] = -1;
+    if (pair > 0 && pair < COLOR_PAIRS &&
+        pair_content(pair, &ansi.pair_fg[pair], &ansi.pair_bg[pair]) != OK) {
+      ansi.pair_fg[pair] = ansi.pair_bg[pair] = -1;
+    }
+  }
+
+  // Let curses clear the screen one last time; from now on its
+  // windows stay untouched and getch does not write anything
+  clear();
+  refresh();
+  return RES_OK;
+}
+
+static void cleanupAnsiBackend(void) {
+  if (ansi.out != NULL) {
+    emit("\033[0m", 4);
+    writeOutput();
+  }
+  free(ansi.front);
+  free(ansi.back);
+  free(ansi.dirty_min);
+  free(ansi.dirty_max);
+  free(ansi.out);
+  memset(&ansi, 0, sizeof(ansi));
+  // Curses does not know the screen any more; let it start over
+  clearok(curscr, TRUE);
+}
+
+static void writeAnsiRun(int y, int x, const chtype* cells, int len) {
+  if (y < 0 || y >= ansi.nrows || x < 0 || x >= ansi.ncols) {
+    return;
+  }
+  if (x + len > ansi.ncols) {
+    len = ansi.ncols - x;
+  }
+  memcpy(&ansi.back[y * ansi.ncols + x], cells, len * sizeof(chtype));
+  if (x < ansi.dirty_min[y]) {
+    ansi.dirty_min[y] = x;
+  }
+  if (x + len - 1 > ansi.dirty_max[y]) {
+    ansi.dirty_max[y] = x + len - 1;
+  }
+}
+
+// Send the cells that differ between back and front buffer
+static void presentAnsi(void) {
+  int y, x;
+
+  for (y = 0; y < ansi.nrows; y++) {
+    chtype* back = &ansi.back[y * ansi.ncols];
+    chtype* front = &ansi.front[y * ansi.ncols];
+
+    for (x = ansi.dirty_min[y]; x <= ansi.dirty_max[y]; x++) {
+      if (back[x] != front[x]) {
+        moveCursor(y, x);
+        putCell(back[x]);
+        front[x] = back[x];
+      }
+    }
+    ansi.dirty_min[y] = ansi.ncols;
+    ansi.dirty_max[y] = -1;
+  }
+  ansi.stats.last_bytes = ansi.out_size;
+  ansi.stats.frames++;
+  if (ansi.out_size > 0) {
+    writeOutput();
+  }
+}
+
+static const struct render_stats* getAnsiStats(void) {
+  return &ansi.stats;
+}
+
+// The terminal keeps what it shows in the part of the window that stays;
+// so do the buffers. New cells are blank on the terminal.
+static void resizeAnsi(int nrows, int ncols) {
+  long ncells = (long)nrows * ncols;
+  chtype* front = malloc(ncells * sizeof(chtype));
+  chtype* back = malloc(ncells * sizeof(chtype));
+  int* dirty_min = malloc(nrows * sizeof(int));
+  int* dirty_max = malloc(nrows * sizeof(int));
+  int y, x;
+
+  if (front == NULL || back == NULL || dirty_min == NULL ||
+      dirty_max == NULL) {
+    free(front);
+    free(back);
+    free(dirty_min);
+    free(dirty_max);
+    return; // Out of memory: we keep drawing into the old size
+  }
+  for (y = 0; y < nrows; y++) {
+    for (x = 0; x < ncols; x++) {
+      bool kept = y < ansi.nrows && x < ansi.ncols;
+      front[y * ncols + x] =
+          kept ? ansi.front[y * ansi.ncols + x] : BLANK_CELL;
+      back[y * ncols + x] = kept ? ansi.back[y * ansi.ncols + x] : BLANK_CELL;
+    }
+    // Cells written but not yet presented stay dirty
+    dirty_min[y] = ncols;
+    dirty_max[y] = -1;
+    if (y < ansi.nrows && ansi.dirty_min[y] <= ansi.dirty_max[y]) {
+      dirty_min[y] = ansi.dirty_min[y];
+      dirty_max[y] = ansi.dirty_max[y] < ncols ? ansi.dirty_max[y] : ncols - 1;
+    }
+  }
+  free(ansi.front);
+  free(ansi.back);
+  free(ansi.dirty_min);
+  free(ansi.dirty_max);
+  ansi.front = front;
+  ansi.back = back;
+  ansi.dirty_min = dirty_min;
+  ansi.dirty_max = dirty_max;
+  ansi.nrows = nrows;
+  ansi.ncols = ncols;
+  ansi.cur_y = -1; // The terminal may have moved the cursor
+  ansi.cur_attr = UNKNOWN_ATTR;
+  // resizeterm has touched the windows of curses; getch must not
+  // refresh them over our output
+  untouchwin(stdscr);
+}
+
+const struct render_backend ansi_backend = {
+    initializeAnsiBackend, cleanupAnsiBackend, writeAnsiRun, presentAnsi,
+    getAnsiStats, resizeAnsi};
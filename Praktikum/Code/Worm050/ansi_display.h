@@ -0,0 +1,33 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A render backend writing ANSI sequences to the terminal
+//
+// The backend keeps two buffers of the screen: the front buffer holds what
+// the terminal shows, the back buffer what the next frame shall show.
+// present() compares the rows written since the last frame and sends
+// only the cells that differ, with the shortest cursor movements and
+// SGR sequences only where the attributes change. The whole frame goes
+// out by a single write().
+//
+// Curses is still initialized for the keyboard, but after the start it
+// does not write to the terminal any more.
+
+#ifndef _ANSI_DISPLAY_H
+#define _ANSI_DISPLAY_H
+
+#include "display.h"
+
+#define ANSI_MAX_PAIRS 16  // Color pairs translated to SGR colors
+#define ANSI_MAX_REWRITE 4 // Rewrite so many unchanged cells at most
+                           // instead of moving the cursor over them
+
+extern const struct render_backend ansi_backend;
+
+#endif  // #define _ANSI_DISPLAY_H
@@ -0,0 +1,269 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The autopilot: a controller that steers the user worm
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "autopilot.h"
+#include "board_model.h"
+#include "game.h"
+#include "rng.h"
+#include "worm.h"
+#include "worm_model.h"
+
+// Marks a cell that is the start of a search
+#define NO_STEP 0xff
+
+// Set up the autopilot for the board of agame. The search arrays are
+// only allocated by prepareAutopilot, when the autopilot is used.
+void initializeAutopilot(struct autopilot* apilot, struct game* agame) {
+  apilot->ncells = (long)(getLastRow(&agame->board) + 1) *
+                   (getLastCol(&agame->board) + 1);
+  apilot->visited = NULL;
+  apilot->first = NULL;
+  apilot->queue = NULL;
+  apilot->search = 0;
+  apilot->decisions = 0;
+  apilot->last_ns = 0;
+  apilot->max_ns = 0;
+  apilot->total_ns = 0;
+  resetAutopilot(apilot, agame);
+}
+
+// Allocate the search arrays unless this has been done already.
+// Must succeed before the first call of steerAutopilot.
+enum ResCodes prepareAutopilot(struct autopilot* apilot) {
+  if (apilot->visited != NULL) {
+    return RES_OK;
+  }
+  apilot->visited = calloc(apilot->ncells, sizeof(uint32_t));
+  apilot->first = malloc(apilot->ncells);
+  apilot->queue = malloc(AUTOPILOT_MAX_NODES * sizeof(int));
+  if (apilot->visited == NULL || apilot->first == NULL ||
+      apilot->queue == NULL) {
+    cleanupAutopilot(apilot);
+    return RES_FAILED;
+  }
+  apilot->search = 0;
+  return RES_OK;
+}
+
+void cleanupAutopilot(struct autopilot* apilot) {
+  free(apilot->visited);
+  free(apilot->first);
+  free(apilot->queue);
+  apilot->visited = NULL;
+  apilot->first = NULL;
+  apilot->queue = NULL;
+}
+
+// Start over for a new game on a board of the same size.
+// The measured times are kept.
+void resetAutopilot(struct autopilot* apilot, struct game* agame) {
+  seedRng(&apilot->rng, agame->settings.seed ^ 0xa5a5a5a5a5a5a5a5ULL);
+  apilot->has_target = false;
+}
+
+// Begin a new search; all cells count as unvisited afterwards
+static void newSearch(struct autopilot* apilot) {
+  if (++apilot->search == 0) {
+    // Wrapped around: forget the old marks for real
+    memset(apilot->visited, 0, apilot->ncells * sizeof(uint32_t));
+    apilot->search = 1;
+  }
+}
+
+static bool isFree(struct board* aboard, struct pos pos) {
+  return isInsideBoard(aboard, pos.y, pos.x) &&
+         getContentAt(aboard, pos.y, pos.x) == BC_FREE_CELL;
+}
+
+// Breadth first search from start over free cells towards goal.
+// goal itself may be occupied (e.g. by the tail that moves on).
+// Returns the first step of a shortest path or -1 if goal is not reachable
+// within AUTOPILOT_MAX_NODES cells.
+static int searchPath(struct autopilot* apilot, struct board* aboard,
+                      struct pos start, struct pos goal) {
+  int ncols = getLastCol(aboard) + 1;
+  int goal_index = goal.y * ncols + goal.x;
+  int head = 0, tail = 0;
+  int dir;
+
+  newSearch(apilot);
+  apilot->visited[start.y * ncols + start.x] = apilot->search;
+  apilot->first[start.y * ncols + start.x] = NO_STEP;
+  apilot->queue[tail++] = start.y * ncols + start.x;
+
+  while (head < tail) {
+    int index = apilot->queue[head++];
+    struct pos pos = {index / ncols, index % ncols};
+
+    for (dir = 0; dir < 4; dir++) {
+      struct pos next = getNeighbourPos(pos, (enum WormHeading)dir);
+      int next_index = next.y * ncols + next.x;
+
+      if (!isInsideBoard(aboard, next.y, next.x) ||
+          apilot->visited[next_index] == apilot->search) {
+        continue;
+      }
+      // The first step of the path is inherited along the way
+      apilot->first[next_index] =
+          apilot->first[index] == NO_STEP ? dir : apilot->first[index];
+      if (next_index == goal_index) {
+        return apilot->first[next_index];
+      }
+      if (getContentAt(aboard, next.y, next.x) != BC_FREE_CELL) {
+        continue;
+      }
+      apilot->visited[next_index] = apilot->search;
+      if (tail == AUTOPILOT_MAX_NODES) {
+        return -1; // Too far away
+      }
+      apilot->queue[tail++] = next_index;
+    }
+  }
+  return -1;
+}
+
+// Number of free cells reachable from start (including start).
+// The count stops at limit.
+static long countRoom(struct autopilot* apilot, struct board* aboard,
+                      struct pos start, long limit) {
+  int ncols = getLastCol(aboard) + 1;
+  int head = 0, tail = 0;
+  int dir;
+
+  if (limit > AUTOPILOT_MAX_NODES) {
+    limit = AUTOPILOT_MAX_NODES;
+  }
+  newSearch(apilot);
+  apilot->visited[start.y * ncols + start.x] = apilot->search;
+  apilot->queue[tail++] = start.y * ncols + start.x;
+
+  while (head < tail && tail < limit) {
+    int index = apilot->queue[head++];
+    struct pos pos = {index / ncols, index % ncols};
+
+    for (dir = 0; dir < 4 && tail < limit; dir++) {
+      struct pos next = getNeighbourPos(pos, (enum WormHeading)dir);
+      int next_index = next.y * ncols + next.x;
+
+      if (isFree(aboard, next) &&
+          apilot->visited[next_index] != apilot->search) {
+        apilot->visited[next_index] = apilot->search;
+        apilot->queue[tail++] = next_index;
+      }
+    }
+  }
+  return tail;
+}
+
+// Choose a free cell near the head as the next target
+static void pickTarget(struct autopilot* apilot, struct board* aboard,
+                       struct pos headpos) {
+  int tries;
+
+  for (tries = 0; tries < AUTOPILOT_TARGET_TRIES; tries++) {
+    struct pos pos;
+    pos.y = headpos.y + randomBelow(&apilot->rng,
+                                    2 * AUTOPILOT_TARGET_RADIUS + 1) -
+            AUTOPILOT_TARGET_RADIUS;
+    pos.x = headpos.x + randomBelow(&apilot->rng,
+                                    2 * AUTOPILOT_TARGET_RADIUS + 1) -
+            AUTOPILOT_TARGET_RADIUS;
+    if (isFree(aboard, pos)) {
+      apilot->target = pos;
+      apilot->has_target = true;
+      return;
+    }
+  }
+  apilot->has_target = false;
+}
+
+// Find the heading of the user worm for the coming tick
+static int decide(struct autopilot* apilot, struct game* agame) {
+  struct board* aboard = &agame->board;
+  struct worm_table* atable = &agame->worms;
+  struct pos headpos = getWormHeadPos(atable, USER_WORM_ID);
+  long length = getWormLength(atable, USER_WORM_ID);
+  long need = length < AUTOPILOT_MAX_NODES ? length : AUTOPILOT_MAX_NODES;
+  long best_room = 0;
+  int best_dir = -1;
+  int dir;
+
+  // 1. Head for the target if there is room enough after the first step
+  if (!apilot->has_target || !isFree(aboard, apilot->target)) {
+    pickTarget(apilot, aboard, headpos);
+  }
+  if (apilot->has_target) {
+    dir = searchPath(apilot, aboard, headpos, apilot->target);
+    if (dir >= 0 &&
+        countRoom(apilot, aboard, getNeighbourPos(headpos, dir), need) >=
+            need) {
+      return dir;
+    }
+    apilot->has_target = false; // Unreachable or a trap: try another one
+  }
+
+  // 2. Chase the tail: where the tail is, there will be room.
+  // The tail cell is freed before the head moves unless the worm grows.
+  if (length > 1) {
+    struct pos tailpos = getWormTailPos(atable, USER_WORM_ID);
+    struct pos next;
+
+    dir = searchPath(apilot, aboard, headpos, tailpos);
+    next = getNeighbourPos(headpos, dir);
+    if (dir >= 0 && (isFree(aboard, next) ||
+                     length >= atable->max_length[USER_WORM_ID])) {
+      return dir;
+    }
+  }
+
+  // 3. Go where there is the most room
+  for (dir = 0; dir < 4; dir++) {
+    struct pos next = getNeighbourPos(headpos, (enum WormHeading)dir);
+    if (isFree(aboard, next)) {
+      long room = countRoom(apilot, aboard, next, length + 1);
+      if (room > best_room) {
+        best_room = room;
+        best_dir = dir;
+      }
+    }
+  }
+  return best_dir;
+}
+
+// Choose the heading of the user worm for the coming tick.
+// Called instead of processing direction keys, right before stepGame.
+void steerAutopilot(struct autopilot* apilot, struct game* agame) {
+  struct timespec start, stop;
+  int dir;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  dir = decide(apilot, agame);
+  if (dir >= 0 && !isWormReversal(&agame->worms, USER_WORM_ID,
+                                  (enum WormHeading)dir)) {
+    setWormHeading(&agame->worms, USER_WORM_ID, (enum WormHeading)dir);
+  }
+  // Else there is no way out; the worm keeps its heading
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  apilot->last_ns = (stop.tv_sec - start.tv_sec) * 1000000000L +
+                    (stop.tv_nsec - start.tv_nsec);
+  if (apilot->last_ns > apilot->max_ns) {
+    apilot->max_ns = apilot->last_ns;
+  }
+  apilot->total_ns += apilot->last_ns;
+  apilot->decisions++;
+}
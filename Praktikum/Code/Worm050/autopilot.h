@@ -0,0 +1,55 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The autopilot: a controller that steers the user worm
+//
+// Each tick the autopilot searches the shortest path over the free cells
+// of the board (breadth first) towards a target near the head. A path is
+// only taken if the worm still finds enough room behind the first step.
+// Otherwise the worm chases its own tail, which keeps a way out open.
+// Targets are chosen by the autopilot's own random numbers; thus the same
+// game always takes the same course.
+
+#ifndef _AUTOPILOT_H
+#define _AUTOPILOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "worm.h"
+#include "game.h"
+#include "rng.h"
+
+#define AUTOPILOT_MAX_NODES 16384   // Maximal number of cells per search
+#define AUTOPILOT_TARGET_RADIUS 40  // Maximal distance of a target
+#define AUTOPILOT_TARGET_TRIES 32   // Attempts to find a free target cell
+
+struct autopilot {
+  long ncells;            // Number of cells of the board
+  uint32_t* visited;      // Per cell: number of the last search visiting it
+  unsigned char* first;   // Per cell: first step of the path leading to it
+  int* queue;             // Cells to be expanded
+  uint32_t search;        // Number of the current search
+  struct rng rng;         // Random numbers for choosing targets
+  struct pos target;      // The cell we are heading for
+  bool has_target;
+
+  // Measured time for the decisions
+  long decisions;         // Number of decisions made
+  long last_ns;           // Time of the last decision
+  long max_ns;            // Longest decision so far
+  double total_ns;        // Sum of all decisions
+};
+
+extern void initializeAutopilot(struct autopilot* apilot, struct game* agame);
+extern enum ResCodes prepareAutopilot(struct autopilot* apilot);
+extern void cleanupAutopilot(struct autopilot* apilot);
+extern void resetAutopilot(struct autopilot* apilot, struct game* agame);
+extern void steerAutopilot(struct autopilot* apilot, struct game* agame);
+
+#endif  // #define _AUTOPILOT_H
@@ -0,0 +1,1051 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Micro benchmarks of the hot paths of the worm and board models
+//
+// The models never call curses; all output goes into the board's list of
+// changes. That list is our screen stub: it is emptied between batches.
+//
+// Each benchmark runs its operation in batches. The batch size is doubled
+// during warmup until a batch takes BENCH_BATCH_NS; then the batch is
+// repeated and timed. We report the median, the 99th percentile and the
+// minimum of the time per operation over all repetitions.
+//
+// The batch queries of the packed bitmap (see board_bitmap.h) are run on
+// boards filled at random, once with AVX2 and once with the scalar
+// versions; the length column holds the number of occupied cells.
+// With --check N we do not measure but compare both versions with the
+// byte grid on N random boards and rectangles instead.
+// With --check-load N we load N damaged copies of a saved game, as left
+// behind by a torn replay or snapshot file; none of them may crash us.
+// A damaged snapshot file must not even get past its CRC.
+//
+// Output: one line of comma separated values per benchmark, preceded by
+// a header line; lines starting with '#' are comments.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "worm.h"
+#include "board_model.h"
+#include "board_bitmap.h"
+#include "game.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "state_buffer.h"
+#include "worm_model.h"
+
+#define BENCH_REPS 101          // Default number of timed batches
+#define BENCH_WARMUP_REPS 3     // Untimed batches before measuring
+#define BENCH_BATCH_NS 200000L  // Minimal duration of a batch
+#define BENCH_MAX_BATCH (1L << 22)
+#define BENCH_POSITIONS 4096    // Random positions for cell operations
+#define BENCH_RECT_ROWS 16      // Maximal size of the rectangles we query
+#define BENCH_RECT_COLS 512
+#define BENCH_CHECK_ROWS 64     // Maximal size of the boards of --check
+#define BENCH_CHECK_COLS 1000
+#define BENCH_CHECK_QUERIES 200 // Queries per board and filling of --check
+#define BENCH_LOAD_TICKS 300    // Ticks played before and after loading
+#define BENCH_LOAD_DAMAGE 8     // Bytes overwritten per copy of --check-load
+
+// The sizes we measure
+static const int board_sizes[][2] = {
+    {24, 80}, {60, 200}, {500, 2000}, {1000, 1000}, {4000, 4000}};
+static const long worm_lengths[] = {20, 1000, 100000, 1000000};
+// Occupied cells per thousand: a board with a few worms and a crowded one
+static const int bitmap_densities[] = {10, 990};
+// Fillings tried by --check, including the empty and the full board
+static const int check_densities[] = {0, 1, 10, 100, 500, 900, 999, 1000};
+
+#define NBOARDS (int)(sizeof(board_sizes) / sizeof(board_sizes[0]))
+#define NLENGTHS (int)(sizeof(worm_lengths) / sizeof(worm_lengths[0]))
+#define NDENSITIES \
+  (int)(sizeof(bitmap_densities) / sizeof(bitmap_densities[0]))
+#define NCHECK_DENSITIES \
+  (int)(sizeof(check_densities) / sizeof(check_densities[0]))
+
+// Settings from the command line
+struct options {
+  int reps;        // Number of timed batches
+  long max_length; // Skip worms longer than this
+  long max_cells;  // Skip boards with more cells than this
+  bool bitmap_avx2;   // Measure the AVX2 versions of the bitmap queries
+  bool bitmap_scalar; // Measure the scalar versions
+  long check_boards;  // > 0: only compare the bitmap queries on so many
+  long check_loads;   // > 0: only load so many damaged saved games
+};
+
+// A rectangle of cells (y0,x0)..(y1,x1), bounds inclusive
+struct rect {
+  int y0, x0;
+  int y1, x1;
+};
+
+// Everything a benchmark works on
+struct bench_state {
+  struct board board;
+  struct worm_table worms;
+  struct pos positions[BENCH_POSITIONS]; // Random cells of the board
+  struct rect rects[BENCH_POSITIONS];    // Random rectangles of the board
+  struct rng rng;                        // For picking random free cells
+  long length;   // Length of the worm (0: no worm)
+  volatile long sink; // Keeps the compiler from dropping results
+};
+
+// An operation is run n times per batch.
+// Returns the time spent in the measured part in nanoseconds.
+typedef long (*bench_op)(struct bench_state* astate, long n);
+
+long nowNs(void);
+int compareDoubles(const void* a, const void* b);
+enum WormHeading cycleHeading(struct board* aboard, struct pos pos);
+long runPlaceItem(struct bench_state* astate, long n);
+long runIsInUseByWorm(struct bench_state* astate, long n);
+long runShowWorm(struct bench_state* astate, long n);
+long runMoveWorms(struct bench_state* astate, long n);
+long runCleanWormTails(struct bench_state* astate, long n);
+long runRandomFreeCell(struct bench_state* astate, long n);
+long runAnyOccupiedInRect(struct bench_state* astate, long n);
+long runCountFreeInRow(struct bench_state* astate, long n);
+long runFindFirstFreeAfter(struct bench_state* astate, long n);
+struct rect randomRect(struct rng* arng, int nrows, int ncols, int max_rows,
+                       int max_cols);
+long fillBoard(struct board* aboard, struct rng* arng, int permille);
+enum ResCodes setupState(struct bench_state* astate, int nrows, int ncols,
+                         long length);
+enum ResCodes setupBitmapState(struct bench_state* astate, int nrows,
+                               int ncols, int permille);
+void cleanupState(struct bench_state* astate);
+void measure(struct options* opts, struct bench_state* astate,
+             const char* name, bench_op op, long max_batch);
+void measureBitmap(struct options* opts, struct bench_state* astate);
+long checkQueries(struct board* aboard, struct rng* arng);
+long checkFreeCells(struct board* aboard, struct rng* arng);
+long checkBitmap(long nboards);
+void playBots(struct game* agame, long ticks);
+void putAt(struct state_buffer* abuf, size_t offset, uint64_t value,
+           int nbytes);
+enum ResCodes loadCopy(const struct game_settings* asettings,
+                       const struct state_buffer* asaved,
+                       struct state_buffer* acopy, uint64_t* ahash,
+                       long* amismatches);
+long checkLoad(long ncopies);
+enum ResCodes damageFile(const char* filename, long offset, long size);
+long checkSnapshot(void);
+void printUsage(char* progname);
+bool parseNumber(char* arg, long min, long* result);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
+
+long nowNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+int compareDoubles(const void* a, const void* b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// ************************************
+// The operations
+// ************************************
+
+// The heading of a worm on a cycle through all cells of the board:
+// serpentine through columns 1.. and back to the top in column 0.
+// The board must have an even number of rows.
+enum WormHeading cycleHeading(struct board* aboard, struct pos pos) {
+  int last_row = getLastRow(aboard);
+  int last_col = getLastCol(aboard);
+
+  if (pos.x == 0) {
+    return pos.y == 0 ? WORM_RIGHT : WORM_UP;
+  }
+  if (pos.y % 2 == 0) {
+    return pos.x < last_col ? WORM_RIGHT : WORM_DOWN;
+  }
+  if (pos.x > 1) {
+    return WORM_LEFT;
+  }
+  return pos.y == last_row ? WORM_LEFT : WORM_DOWN;
+}
+
+// Move the worm n steps along the cycle; it grows by n elements
+static void stepWorm(struct bench_state* astate, long n) {
+  long i;
+  for (i = 0; i < n; i++) {
+    setWormHeading(&astate->worms, 0,
+                   cycleHeading(&astate->board,
+                                getWormHeadPos(&astate->worms, 0)));
+    moveWorms(&astate->board, &astate->worms);
+  }
+}
+
+// Shrink the worm by n elements
+static void shrinkWorm(struct bench_state* astate, long n) {
+  long i;
+  for (i = 0; i < n; i++) {
+    cleanWormTails(&astate->board, &astate->worms);
+  }
+}
+
+long runPlaceItem(struct bench_state* astate, long n) {
+  long start, i;
+
+  clearChanges(&astate->board);
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    struct pos pos = astate->positions[i % BENCH_POSITIONS];
+    if (i & 1) {
+      placeItem(&astate->board, pos.y, pos.x, BC_FREE_CELL, SYMBOL_FREE_CELL,
+                COLP_FREE_CELL);
+    } else {
+      placeItem(&astate->board, pos.y, pos.x, BC_USED_BY_WORM,
+                SYMBOL_WORM_INNER_ELEMENT, COLP_USER_WORM);
+    }
+  }
+  return nowNs() - start;
+}
+
+long runIsInUseByWorm(struct bench_state* astate, long n) {
+  long start, i;
+  long hits = 0;
+
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    hits += isInUseByWorm(&astate->board,
+                          astate->positions[i % BENCH_POSITIONS]);
+  }
+  start = nowNs() - start;
+  astate->sink += hits;
+  return start;
+}
+
+long runShowWorm(struct bench_state* astate, long n) {
+  long start, i;
+
+  clearChanges(&astate->board);
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    showWorm(&astate->board, &astate->worms, 0);
+  }
+  return nowNs() - start;
+}
+
+// Time n steps of the worm; afterwards it is shrunk to its length again
+long runMoveWorms(struct bench_state* astate, long n) {
+  long start, elapsed;
+
+  clearChanges(&astate->board);
+  start = nowNs();
+  stepWorm(astate, n);
+  elapsed = nowNs() - start;
+  shrinkWorm(astate, n);
+  return elapsed;
+}
+
+// Let the worm grow by n elements, then time cutting them off again
+long runCleanWormTails(struct bench_state* astate, long n) {
+  long start;
+
+  stepWorm(astate, n);
+  clearChanges(&astate->board);
+  start = nowNs();
+  shrinkWorm(astate, n);
+  return nowNs() - start;
+}
+
+// Pick n random free cells; the board must keep its free cells
+long runRandomFreeCell(struct bench_state* astate, long n) {
+  struct pos pos = {0, 0};
+  long start, i;
+  long sum = 0;
+
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    randomFreeCell(&astate->board, &astate->rng, &pos);
+    sum += pos.y + pos.x;
+  }
+  start = nowNs() - start;
+  astate->sink += sum;
+  return start;
+}
+
+long runAnyOccupiedInRect(struct bench_state* astate, long n) {
+  long start, i;
+  long hits = 0;
+
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    struct rect* r = &astate->rects[i % BENCH_POSITIONS];
+    hits += anyOccupiedInRect(&astate->board.bitmap, r->y0, r->x0, r->y1,
+                              r->x1);
+  }
+  start = nowNs() - start;
+  astate->sink += hits;
+  return start;
+}
+
+long runCountFreeInRow(struct bench_state* astate, long n) {
+  long start, i;
+  long sum = 0;
+
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    sum += countFreeInRow(&astate->board.bitmap,
+                          astate->positions[i % BENCH_POSITIONS].y);
+  }
+  start = nowNs() - start;
+  astate->sink += sum;
+  return start;
+}
+
+long runFindFirstFreeAfter(struct bench_state* astate, long n) {
+  int free_y = 0, free_x = 0;
+  long start, i;
+  long sum = 0;
+
+  start = nowNs();
+  for (i = 0; i < n; i++) {
+    struct pos pos = astate->positions[i % BENCH_POSITIONS];
+    if (findFirstFreeAfter(&astate->board.bitmap, pos.y, pos.x, &free_y,
+                           &free_x)) {
+      sum += free_y + free_x;
+    }
+  }
+  start = nowNs() - start;
+  astate->sink += sum;
+  return start;
+}
+
+// ************************************
+// Setup and measurement
+// ************************************
+
+// A random rectangle of at most max_rows x max_cols cells on the board
+struct rect randomRect(struct rng* arng, int nrows, int ncols, int max_rows,
+                       int max_cols) {
+  struct rect r;
+
+  r.y0 = randomBelow(arng, nrows);
+  r.x0 = randomBelow(arng, ncols);
+  r.y1 = r.y0 + randomBelow(arng, max_rows);
+  r.x1 = r.x0 + randomBelow(arng, max_cols);
+  if (r.y1 >= nrows) {
+    r.y1 = nrows - 1;
+  }
+  if (r.x1 >= ncols) {
+    r.x1 = ncols - 1;
+  }
+  return r;
+}
+
+// Occupy each cell of the board with a probability of permille / 1000
+// and free all others. Returns the number of occupied cells.
+long fillBoard(struct board* aboard, struct rng* arng, int permille) {
+  long occupied = 0;
+  int y, x;
+
+  for (y = 0; y <= getLastRow(aboard); y++) {
+    for (x = 0; x <= getLastCol(aboard); x++) {
+      bool used = randomBelow(arng, 1000) < permille;
+      setContentAt(aboard, y, x, used ? BC_USED_BY_WORM : BC_FREE_CELL);
+      occupied += used;
+    }
+  }
+  return occupied;
+}
+
+// A board of nrows x ncols with a worm of the given length running along
+// the cycle. Without a worm (length 0), every other of the random
+// positions is occupied instead.
+enum ResCodes setupState(struct bench_state* astate, int nrows, int ncols,
+                         long length) {
+  struct pos start = {0, 0};
+  long i;
+
+  if (initializeBoard(&astate->board, nrows, ncols) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (initializeWormTable(&astate->worms, 1) != RES_OK) {
+    cleanupBoard(&astate->board);
+    return RES_FAILED;
+  }
+  seedRng(&astate->rng, 4711);
+  for (i = 0; i < BENCH_POSITIONS; i++) {
+    astate->positions[i].y = randomBelow(&astate->rng, nrows);
+    astate->positions[i].x = randomBelow(&astate->rng, ncols);
+  }
+  astate->length = length;
+  astate->sink = 0;
+
+  if (length == 0) {
+    // Cell operations: a board half full
+    for (i = 0; i < BENCH_POSITIONS; i += 2) {
+      setContentAt(&astate->board, astate->positions[i].y,
+                   astate->positions[i].x, BC_USED_BY_WORM);
+    }
+    return RES_OK;
+  }
+  // The worm grows to its length, then keeps it
+  addWorm(&astate->worms, length, start, WORM_RIGHT, COLP_USER_WORM);
+  stepWorm(astate, length - 1);
+  clearChanges(&astate->board);
+  return RES_OK;
+}
+
+// A board of nrows x ncols with the packed bitmap switched on, filled
+// at random with permille occupied cells per thousand
+enum ResCodes setupBitmapState(struct bench_state* astate, int nrows,
+                               int ncols, int permille) {
+  long i;
+
+  if (initializeBoard(&astate->board, nrows, ncols) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (enableBoardBitmap(&astate->board) != RES_OK ||
+      initializeWormTable(&astate->worms, 1) != RES_OK) {
+    cleanupBoard(&astate->board);
+    return RES_FAILED;
+  }
+  seedRng(&astate->rng, 4711);
+  for (i = 0; i < BENCH_POSITIONS; i++) {
+    astate->positions[i].y = randomBelow(&astate->rng, nrows);
+    astate->positions[i].x = randomBelow(&astate->rng, ncols);
+    astate->rects[i] = randomRect(&astate->rng, nrows, ncols,
+                                  BENCH_RECT_ROWS, BENCH_RECT_COLS);
+  }
+  astate->length = fillBoard(&astate->board, &astate->rng, permille);
+  astate->sink = 0;
+  return RES_OK;
+}
+
+void cleanupState(struct bench_state* astate) {
+  cleanupWormTable(&astate->worms);
+  cleanupBoard(&astate->board);
+}
+
+// Find the batch size, run the timed batches and print one line
+void measure(struct options* opts, struct bench_state* astate,
+             const char* name, bench_op op, long max_batch) {
+  double* samples = malloc(opts->reps * sizeof(double));
+  long batch = 1;
+  int i;
+
+  if (samples == NULL) {
+    return;
+  }
+  if (max_batch > BENCH_MAX_BATCH) {
+    max_batch = BENCH_MAX_BATCH;
+  }
+  // Warmup: grow the batch until it takes long enough to be timed
+  while (batch < max_batch && op(astate, batch) < BENCH_BATCH_NS) {
+    batch *= 2;
+  }
+  if (batch > max_batch) {
+    batch = max_batch;
+  }
+  for (i = 0; i < BENCH_WARMUP_REPS; i++) {
+    op(astate, batch);
+  }
+  for (i = 0; i < opts->reps; i++) {
+    samples[i] = (double)op(astate, batch) / batch;
+  }
+  qsort(samples, opts->reps, sizeof(double), compareDoubles);
+
+  printf("%s,%d,%d,%ld,%ld,%d,%.2f,%.2f,%.2f\n", name,
+         getLastRow(&astate->board) + 1, getLastCol(&astate->board) + 1,
+         astate->length, batch, opts->reps, samples[opts->reps / 2],
+         samples[(opts->reps * 99 + 99) / 100 - 1], samples[0]);
+  fflush(stdout);
+  free(samples);
+}
+
+// Measure the batch queries of the bitmap with the versions asked for
+void measureBitmap(struct options* opts, struct bench_state* astate) {
+  static const char* queries[] = {"anyOccupiedInRect", "countFreeInRow",
+                                  "findFirstFreeAfter"};
+  static const bench_op ops[] = {runAnyOccupiedInRect, runCountFreeInRow,
+                                 runFindFirstFreeAfter};
+  char name[64];
+  int simd, q;
+
+  for (simd = 1; simd >= 0; simd--) {
+    if (!(simd ? opts->bitmap_avx2 : opts->bitmap_scalar)) {
+      continue;
+    }
+    if (setBitmapSimd(simd) != simd) {
+      continue; // No AVX2 on this CPU
+    }
+    for (q = 0; q < 3; q++) {
+      snprintf(name, sizeof(name), "%s.%s", queries[q],
+               simd ? "avx2" : "scalar");
+      measure(opts, astate, name, ops[q], BENCH_MAX_BATCH);
+    }
+  }
+  setBitmapSimd(true);
+}
+
+// ************************************
+// Comparing the versions of the bitmap queries
+// ************************************
+
+// Run random queries against the bitmap, with AVX2 and without, and
+// against the byte grid. Returns the number of mismatches.
+long checkQueries(struct board* aboard, struct rng* arng) {
+  const struct bitmap* abitmap = &aboard->bitmap;
+  int nrows = getLastRow(aboard) + 1;
+  int ncols = getLastCol(aboard) + 1;
+  long mismatches = 0;
+  int q, simd, y, x;
+
+  for (q = 0; q < BENCH_CHECK_QUERIES; q++) {
+    struct rect r = randomRect(arng, nrows, ncols, nrows, ncols);
+    struct pos pos = {randomBelow(arng, nrows), randomBelow(arng, ncols)};
+    bool any = false;
+    int row_free = 0;
+    bool found = false;
+    int free_y = -1, free_x = -1;
+    long i;
+
+    // The answers of the byte grid
+    for (y = r.y0; y <= r.y1; y++) {
+      for (x = r.x0; x <= r.x1; x++) {
+        any = any || getContentAt(aboard, y, x) != BC_FREE_CELL;
+      }
+    }
+    for (x = 0; x < ncols; x++) {
+      row_free += getContentAt(aboard, pos.y, x) == BC_FREE_CELL;
+    }
+    for (i = (long)pos.y * ncols + pos.x + 1;
+         !found && i < (long)nrows * ncols; i++) {
+      if (getContentAt(aboard, i / ncols, i % ncols) == BC_FREE_CELL) {
+        found = true;
+        free_y = i / ncols;
+        free_x = i % ncols;
+      }
+    }
+
+    for (simd = 0; simd <= 1; simd++) {
+      const char* version = setBitmapSimd(simd) ? "avx2" : "scalar";
+      int y1 = -1, x1 = -1;
+
+      if (anyOccupiedInRect(abitmap, r.y0, r.x0, r.y1, r.x1) != any) {
+        fprintf(stderr,
+                "Abweichung %s: anyOccupiedInRect %dx%d (%d,%d)..(%d,%d)\n",
+                version, nrows, ncols, r.y0, r.x0, r.y1, r.x1);
+        mismatches++;
+      }
+      if (countFreeInRow(abitmap, pos.y) != row_free) {
+        fprintf(stderr, "Abweichung %s: countFreeInRow %dx%d Zeile %d\n",
+                version, nrows, ncols, pos.y);
+        mismatches++;
+      }
+      if (findFirstFreeAfter(abitmap, pos.y, pos.x, &y1, &x1) != found ||
+          (found && (y1 != free_y || x1 != free_x))) {
+        fprintf(stderr, "Abweichung %s: findFirstFreeAfter %dx%d (%d,%d)\n",
+                version, nrows, ncols, pos.y, pos.x);
+        mismatches++;
+      }
+    }
+  }
+  setBitmapSimd(true);
+  return mismatches;
+}
+
+// Check the set of free cells of aboard against the byte grid: it must
+// hold every free cell exactly once, and random picks must be free.
+// Returns the number of mismatches.
+long checkFreeCells(struct board* aboard, struct rng* arng) {
+  const struct free_cells* afree = &aboard->free;
+  int nrows = getLastRow(aboard) + 1;
+  int ncols = getLastCol(aboard) + 1;
+  long mismatches = 0;
+  int nfree = 0;
+  int q, i;
+
+  for (i = 0; i < nrows * ncols; i++) {
+    if (getContentAt(aboard, i / ncols, i % ncols) != BC_FREE_CELL) {
+      continue;
+    }
+    nfree++;
+    if (afree->slots[i] < 0 || afree->slots[i] >= afree->count ||
+        afree->cells[afree->slots[i]] != i) {
+      fprintf(stderr, "Abweichung: freie Zelle (%d,%d) %dx%d nicht in Menge\n",
+              i / ncols, i % ncols, nrows, ncols);
+      mismatches++;
+    }
+  }
+  if (countFreeCells(aboard) != nfree) {
+    fprintf(stderr, "Abweichung: countFreeCells %dx%d: %d statt %d\n", nrows,
+            ncols, countFreeCells(aboard), nfree);
+    mismatches++;
+  }
+  for (q = 0; q < BENCH_CHECK_QUERIES; q++) {
+    struct pos pos;
+    if (randomFreeCell(aboard, arng, &pos) != (nfree > 0) ||
+        (nfree > 0 && getContentAt(aboard, pos.y, pos.x) != BC_FREE_CELL)) {
+      fprintf(stderr, "Abweichung: randomFreeCell %dx%d (%d,%d)\n", nrows,
+              ncols, pos.y, pos.x);
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+// Compare the bitmap queries and the set of free cells with the byte grid
+// on nboards random boards. Each board is filled twice, so both must
+// follow cells being occupied and freed.
+// Returns the number of mismatches.
+long checkBitmap(long nboards) {
+  struct board board;
+  struct rng rng;
+  long mismatches = 0;
+  long b;
+  int round;
+
+  seedRng(&rng, 4711);
+  for (b = 0; b < nboards; b++) {
+    int nrows = 1 + randomBelow(&rng, BENCH_CHECK_ROWS);
+    int ncols = 1 + randomBelow(&rng, BENCH_CHECK_COLS);
+
+    if (initializeBoard(&board, nrows, ncols) != RES_OK) {
+      fprintf(stderr, "Kein Speicher fuer %dx%d\n", nrows, ncols);
+      return mismatches + 1;
+    }
+    if (enableBoardBitmap(&board) != RES_OK ||
+        enableFreeCells(&board) != RES_OK) {
+      fprintf(stderr, "Kein Speicher fuer %dx%d\n", nrows, ncols);
+      cleanupBoard(&board);
+      return mismatches + 1;
+    }
+    for (round = 0; round < 2; round++) {
+      fillBoard(&board, &rng,
+                check_densities[randomBelow(&rng, NCHECK_DENSITIES)]);
+      mismatches += checkQueries(&board, &rng);
+      mismatches += checkFreeCells(&board, &rng);
+    }
+    cleanupBoard(&board);
+  }
+  return mismatches;
+}
+
+// ************************************
+// Loading damaged saved games
+// ************************************
+
+// Let all worms including the user worm be steered by chance
+void playBots(struct game* agame, long ticks) {
+  long t;
+
+  for (t = 0; t < ticks && agame->game_state == WORM_GAME_ONGOING; t++) {
+    steerBot(agame, USER_WORM_ID);
+    stepGame(agame);
+  }
+}
+
+// Overwrite nbytes at offset of abuf by value in little endian byte order
+void putAt(struct state_buffer* abuf, size_t offset, uint64_t value,
+           int nbytes) {
+  int i;
+
+  for (i = 0; i < nbytes; i++) {
+    abuf->data[offset + i] = (unsigned char)(value >> (8 * i));
+  }
+}
+
+// Load the game in acopy into a new game and play on.
+// The set of free cells is checked after loading and after playing; its
+// mismatches are added to *amismatches.
+// Returns the result of loadGame; *ahash is the fingerprint after loading.
+enum ResCodes loadCopy(const struct game_settings* asettings,
+                       const struct state_buffer* asaved,
+                       struct state_buffer* acopy, uint64_t* ahash,
+                       long* amismatches) {
+  struct state_buffer buf;
+  struct game loaded;
+  struct rng rng;
+  enum ResCodes res_code;
+
+  if (initializeGame(&loaded, asettings) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (enableFreeCells(&loaded.board) != RES_OK) {
+    cleanupGame(&loaded);
+    return RES_FAILED;
+  }
+  seedRng(&rng, 4711);
+  viewStateBuffer(&buf, acopy->data, acopy->size);
+  res_code = loadGame(&loaded, &buf);
+  if (res_code == RES_OK) {
+    *ahash = hashGame(&loaded);
+    *amismatches += checkFreeCells(&loaded.board, &rng);
+    playBots(&loaded, BENCH_LOAD_TICKS);
+    *amismatches += checkFreeCells(&loaded.board, &rng);
+  }
+  cleanupGame(&loaded);
+  // Undo the damage for the next copy
+  memcpy(acopy->data, asaved->data, asaved->size);
+  return res_code;
+}
+
+// Save a game of bots and load it again: intact, with damage the loader
+// must notice and with ncopies random damages. The latter may be loaded
+// or rejected; either way the program must survive, and a loaded game
+// must have a correct set of free cells.
+// Returns the number of errors.
+long checkLoad(long ncopies) {
+  struct game_settings settings;
+  struct game thegame;
+  struct state_buffer saved, copy;
+  struct rng rng;
+  size_t cells, looks, worm, ncells;
+  uint64_t hash = 0, loaded_hash = 0;
+  long errors = 0;
+  long c;
+  int nlooks, d;
+
+  defaultGameSettings(&settings);
+  settings.nrows = 20;
+  settings.ncols = 40;
+  settings.nworms = 8;
+  settings.seed = 3; // The user worm survives all ticks played
+  if (initializeGame(&thegame, &settings) != RES_OK) {
+    return 1;
+  }
+  playBots(&thegame, BENCH_LOAD_TICKS);
+  if (initializeStateBuffer(&saved, savedGameSize(&thegame)) != RES_OK ||
+      initializeStateBuffer(&copy, savedGameSize(&thegame)) != RES_OK) {
+    cleanupStateBuffer(&saved);
+    cleanupGame(&thegame);
+    return 1;
+  }
+  saveGame(&thegame, &saved);
+  putBytes(&copy, saved.data, saved.size);
+  hash = hashGame(&thegame);
+  cleanupGame(&thegame);
+
+  // Where the parts of the saved game begin (see saveGame, saveBoard and
+  // saveWormTable)
+  ncells = (size_t)settings.nrows * settings.ncols;
+  cells = 4 + 8 + 1 + 8 + 8 * (size_t)settings.nworms + 4 + 4;
+  nlooks = saved.data[cells];
+  cells += 1 + 9 * (size_t)nlooks;
+  looks = cells + ncells;
+  worm = looks + ncells + 4; // The user worm
+
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) != RES_OK ||
+      loaded_hash != hash) {
+    fprintf(stderr, "Gespeichertes Spiel nicht wiederhergestellt\n");
+    errors++;
+  }
+  putAt(&copy, looks, nlooks, 1);
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) == RES_OK) {
+    fprintf(stderr, "Aussehen %d ausserhalb der Tabelle geladen\n", nlooks);
+    errors++;
+  }
+  putAt(&copy, cells, BC_USED_BY_WORM + 1, 1);
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) == RES_OK) {
+    fprintf(stderr, "Unbekannter Zellinhalt geladen\n");
+    errors++;
+  }
+  putAt(&copy, worm + 12, settings.nrows, 4);
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) == RES_OK) {
+    fprintf(stderr, "Kopf ausserhalb des Spielfelds geladen\n");
+    errors++;
+  }
+  putAt(&copy, worm + 41, (uint32_t)-1, 4);
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) == RES_OK) {
+    fprintf(stderr, "Wurmelement ausserhalb des Spielfelds geladen\n");
+    errors++;
+  }
+  putAt(&copy, worm + 29, ncells + 1, 8);
+  if (loadCopy(&settings, &saved, &copy, &loaded_hash, &errors) == RES_OK) {
+    fprintf(stderr, "Wurm laenger als das Spielfeld geladen\n");
+    errors++;
+  }
+
+  seedRng(&rng, 4711);
+  for (c = 0; c < ncopies; c++) {
+    for (d = 0; d < BENCH_LOAD_DAMAGE; d++) {
+      copy.data[randomBelow(&rng, (int)copy.size)] =
+          (unsigned char)randomBelow(&rng, 256);
+    }
+    loadCopy(&settings, &saved, &copy, &loaded_hash, &errors);
+  }
+  cleanupStateBuffer(&saved);
+  cleanupStateBuffer(&copy);
+  return errors;
+}
+
+// Replace the file by its first size bytes; with offset >= 0 the byte at
+// offset is flipped, too
+enum ResCodes damageFile(const char* filename, long offset, long size) {
+  FILE* file = fopen(filename, "r+b");
+  int c;
+
+  if (file == NULL) {
+    return RES_FAILED;
+  }
+  if (offset >= 0) {
+    if (fseek(file, offset, SEEK_SET) != 0 || (c = fgetc(file)) == EOF ||
+        fseek(file, offset, SEEK_SET) != 0 || fputc(c ^ 0xff, file) == EOF) {
+      fclose(file);
+      return RES_FAILED;
+    }
+  }
+  if (fclose(file) != 0 || truncate(filename, size) != 0) {
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Take a snapshot of a game of bots and load it into another game,
+// intact, with a flipped byte and cut short. Damaged snapshots must be
+// rejected and leave the other game as it is.
+// Returns the number of errors.
+long checkSnapshot(void) {
+  char filename[] = "/tmp/worm-bench-XXXXXX";
+  struct game_settings settings;
+  struct snapshot_writer writer;
+  struct game saved, thegame;
+  struct stat st;
+  uint64_t hash;
+  long errors = 0;
+  long size;
+  int fd;
+
+  fd = mkstemp(filename);
+  if (fd < 0) {
+    return 1;
+  }
+  close(fd);
+  defaultGameSettings(&settings);
+  settings.nrows = 20;
+  settings.ncols = 40;
+  settings.nworms = 8;
+  settings.seed = 4711;
+  if (initializeGame(&saved, &settings) != RES_OK) {
+    remove(filename);
+    return 1;
+  }
+  if (initializeGame(&thegame, &settings) != RES_OK) {
+    cleanupGame(&saved);
+    remove(filename);
+    return 1;
+  }
+  playBots(&saved, BENCH_LOAD_TICKS);
+  if (initializeSnapshotWriter(&writer, filename, &saved) != RES_OK) {
+    errors++;
+  } else {
+    saveSnapshot(&writer, &saved);
+    if (waitForSnapshots(&writer) != RES_OK) {
+      errors++;
+    }
+    cleanupSnapshotWriter(&writer);
+  }
+
+  if (loadSnapshot(filename, &thegame) != RES_OK ||
+      hashGame(&thegame) != hashGame(&saved)) {
+    fprintf(stderr, "Schnappschuss nicht wiederhergestellt\n");
+    errors++;
+  }
+  cleanupGame(&thegame);
+  if (initializeGame(&thegame, &settings) != RES_OK) {
+    cleanupGame(&saved);
+    remove(filename);
+    return errors + 1;
+  }
+  hash = hashGame(&thegame);
+  size = stat(filename, &st) == 0 ? (long)st.st_size : 0;
+  if (damageFile(filename, size / 2, size) != RES_OK ||
+      loadSnapshot(filename, &thegame) == RES_OK ||
+      hashGame(&thegame) != hash) {
+    fprintf(stderr, "Beschaedigter Schnappschuss geladen\n");
+    errors++;
+  }
+  if (damageFile(filename, -1, size / 2) != RES_OK ||
+      loadSnapshot(filename, &thegame) == RES_OK ||
+      hashGame(&thegame) != hash) {
+    fprintf(stderr, "Abgeschnittener Schnappschuss geladen\n");
+    errors++;
+  }
+  cleanupGame(&saved);
+  cleanupGame(&thegame);
+  remove(filename);
+  return errors;
+}
+
+// ********************************************************************************************
+// MAIN
+// ********************************************************************************************
+
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr,
+          "Aufruf: %s [--reps N] [--max-length L] [--max-cells N]\n"
+          "          [--bitmap avx2|scalar|both|off] [--check N]\n"
+          "          [--check-load N]\n",
+          progname);
+}
+
+// Parse a number >= min; returns false if arg is not such a number
+bool parseNumber(char* arg, long min, long* result) {
+  char* end;
+  *result = strtol(arg, &end, 10);
+  return *arg != '\0' && *end == '\0' && *result >= min;
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  long value;
+  int i;
+
+  opts->reps = BENCH_REPS;
+  opts->max_length = worm_lengths[NLENGTHS - 1];
+  opts->max_cells = (long)board_sizes[NBOARDS - 1][0] *
+                    board_sizes[NBOARDS - 1][1];
+  opts->bitmap_avx2 = true;
+  opts->bitmap_scalar = true;
+  opts->check_boards = 0;
+  opts->check_loads = 0;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return RES_FAILED; // All options have an argument
+    }
+    if (strcmp(argv[i], "--reps") == 0 &&
+        parseNumber(argv[i + 1], 1, &value) && value <= 100000) {
+      opts->reps = (int)value;
+    } else if (strcmp(argv[i], "--max-length") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->max_length = value;
+    } else if (strcmp(argv[i], "--max-cells") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->max_cells = value;
+    } else if (strcmp(argv[i], "--bitmap") == 0 &&
+               (strcmp(argv[i + 1], "avx2") == 0 ||
+                strcmp(argv[i + 1], "scalar") == 0 ||
+                strcmp(argv[i + 1], "both") == 0 ||
+                strcmp(argv[i + 1], "off") == 0)) {
+      opts->bitmap_avx2 = strcmp(argv[i + 1], "avx2") == 0 ||
+                          strcmp(argv[i + 1], "both") == 0;
+      opts->bitmap_scalar = strcmp(argv[i + 1], "scalar") == 0 ||
+                            strcmp(argv[i + 1], "both") == 0;
+    } else if (strcmp(argv[i], "--check") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->check_boards = value;
+    } else if (strcmp(argv[i], "--check-load") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->check_loads = value;
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
+  struct options opts;
+  struct bench_state* astate; // Too large for the stack
+  long mismatches;
+  int b, l, d;
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+  if (opts.check_boards > 0) {
+    mismatches = checkBitmap(opts.check_boards);
+    printf("# Bitmap-Abfragen auf %ld Spielfeldern verglichen (AVX2: %s): "
+           "%ld Abweichungen\n",
+           opts.check_boards, setBitmapSimd(true) ? "ja" : "nein",
+           mismatches);
+    return mismatches == 0 ? RES_OK : RES_FAILED;
+  }
+  if (opts.check_loads > 0) {
+    mismatches = checkLoad(opts.check_loads) + checkSnapshot();
+    printf("# %ld beschaedigte Spielstaende geladen: %ld Fehler\n",
+           opts.check_loads, mismatches);
+    return mismatches == 0 ? RES_OK : RES_FAILED;
+  }
+  astate = malloc(sizeof(struct bench_state));
+  if (astate == NULL) {
+    return RES_FAILED;
+  }
+
+  printf("# Zeiten in ns pro Operation\n");
+  printf("benchmark,rows,cols,length,batch,reps,median_ns,p99_ns,min_ns\n");
+  for (b = 0; b < NBOARDS; b++) {
+    int nrows = board_sizes[b][0];
+    int ncols = board_sizes[b][1];
+    long ncells = (long)nrows * ncols;
+
+    if (ncells > opts.max_cells) {
+      continue;
+    }
+    // Operations on single cells do not depend on worms
+    if (setupState(astate, nrows, ncols, 0) != RES_OK) {
+      fprintf(stderr, "Kein Speicher fuer %dx%d\n", nrows, ncols);
+      continue;
+    }
+    measure(&opts, astate, "placeItem", runPlaceItem, BENCH_MAX_BATCH);
+    measure(&opts, astate, "isInUseByWorm", runIsInUseByWorm,
+            BENCH_MAX_BATCH);
+    cleanupState(astate);
+
+    for (d = 0; d < NDENSITIES; d++) {
+      if (!opts.bitmap_avx2 && !opts.bitmap_scalar) {
+        break;
+      }
+      if (setupBitmapState(astate, nrows, ncols, bitmap_densities[d]) !=
+          RES_OK) {
+        fprintf(stderr, "Kein Speicher fuer %dx%d\n", nrows, ncols);
+        continue;
+      }
+      measureBitmap(&opts, astate);
+      cleanupState(astate);
+    }
+
+    for (l = 0; l < NLENGTHS; l++) {
+      long length = worm_lengths[l];
+      // The worm and the elements added by a batch must fit the cycle
+      long max_batch = (ncells - length) / 2;
+
+      if (length > opts.max_length || max_batch < 1) {
+        continue;
+      }
+      if (setupState(astate, nrows, ncols, length) != RES_OK) {
+        fprintf(stderr, "Kein Speicher fuer %dx%d\n", nrows, ncols);
+        continue;
+      }
+      measure(&opts, astate, "showWorm", runShowWorm, BENCH_MAX_BATCH);
+      measure(&opts, astate, "moveWorms", runMoveWorms, max_batch);
+      measure(&opts, astate, "cleanWormTails", runCleanWormTails, max_batch);
+      // The longer the worm, the fuller the board
+      if (enableFreeCells(&astate->board) == RES_OK) {
+        measure(&opts, astate, "randomFreeCell", runRandomFreeCell,
+                BENCH_MAX_BATCH);
+      }
+      cleanupState(astate);
+    }
+  }
+  free(astate);
+  return RES_OK;
+}
@@ -0,0 +1,48 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Bit-packed occupancy of the board: one bit per cell.
+// Each row is padded to a multiple of 64 bits; padding bits are always 0.
+// The batch queries use AVX2 if the CPU supports it and a scalar
+// version otherwise; a short run of words is always ORed scalar.
+// board_bitmap.c is compiled with -O2 (see Makefile); without it the
+// AVX2 versions are slower than the scalar ones.
+
+#ifndef _BOARD_BITMAP_H
+#define _BOARD_BITMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "worm.h"
+
+struct bitmap {
+  int nrows;          // Number of rows
+  int ncols;          // Number of columns
+  int words_per_row;  // Number of 64-bit words per row (incl. padding)
+  uint64_t* words;    // nrows * words_per_row words; NULL if not in use
+};
+
+extern enum ResCodes initializeBitmap(struct bitmap* abitmap, int nrows,
+                                      int ncols);
+extern void cleanupBitmap(struct bitmap* abitmap);
+extern bool setBitmapSimd(bool enable);
+
+// Single cells
+extern void setBit(struct bitmap* abitmap, int y, int x);
+extern void clearBit(struct bitmap* abitmap, int y, int x);
+extern bool testBit(const struct bitmap* abitmap, int y, int x);
+
+// Batch queries
+extern bool anyOccupiedInRect(const struct bitmap* abitmap, int y0, int x0,
+                              int y1, int x1);
+extern int countFreeInRow(const struct bitmap* abitmap, int y);
+extern bool findFirstFreeAfter(const struct bitmap* abitmap, int y, int x,
+                               int* free_y, int* free_x);
+
+#endif  // #define _BOARD_BITMAP_H
@@ -11,19 +11,323 @@
 #include "board_model.h"
 #include "worm.h"
 #include <curses.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
-void placeItem(int y, int x, chtype symbol, enum ColorPairs color_pair) {
+// Initial number of elements in the list of changed cells
+#define INITIAL_CHANGES_CAPACITY 64
 
-  //  Store item on the display (symbol code)
-  move(y, x);
-  attron(COLOR_PAIR(color_pair));
-  addch(symbol);
-  attroff(COLOR_PAIR(color_pair));
+// Switch the set of free cells off
+static void cleanupFreeCells(struct board* aboard) {
+  free(aboard->free.cells);
+  free(aboard->free.slots);
+  aboard->free.cells = NULL;
+  aboard->free.slots = NULL;
+  aboard->free.count = 0;
 }
+
+// Initialize the board with nrows rows and ncols columns.
+// Cells are indexed by an int (y * ncols + x); larger boards are refused.
+enum ResCodes initializeBoard(struct board* aboard, int nrows, int ncols) {
+  if (nrows < 1 || ncols < 1 || (long)nrows * ncols > INT_MAX) {
+    return RES_FAILED;
+  }
+  aboard->last_row = nrows - 1;
+  aboard->last_col = ncols - 1;
+
+  // One byte per cell; all cells are free at the beginning
+  aboard->cells = malloc((size_t)nrows * ncols);
+  aboard->looks = calloc((size_t)nrows * ncols, 1);
+  if (aboard->cells == NULL || aboard->looks == NULL) {
+    free(aboard->cells);
+    free(aboard->looks);
+    return RES_FAILED;
+  }
+  memset(aboard->cells, BC_FREE_CELL, (size_t)nrows * ncols);
+  // Look 0 is the free cell
+  aboard->look_table[0].symbol = SYMBOL_FREE_CELL;
+  aboard->look_table[0].color_pair = COLP_FREE_CELL;
+  aboard->nlooks = 1;
+  aboard->bitmap.words = NULL; // The packed bitmap is switched on on demand
+  aboard->free.cells = NULL;   // So is the set of free cells
+  aboard->free.slots = NULL;
+  aboard->free.count = 0;
+
+  aboard->changes.count = 0;
+  aboard->changes.capacity = INITIAL_CHANGES_CAPACITY;
+  aboard->changes.cells =
+      malloc(INITIAL_CHANGES_CAPACITY * sizeof(struct cell_change));
+  if (aboard->changes.cells == NULL) {
+    free(aboard->cells);
+    free(aboard->looks);
+    aboard->cells = NULL;
+    aboard->looks = NULL;
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Free all memory held by the board
+void cleanupBoard(struct board* aboard) {
+  free(aboard->cells);
+  free(aboard->looks);
+  aboard->cells = NULL;
+  aboard->looks = NULL;
+  cleanupBitmap(&aboard->bitmap);
+  cleanupFreeCells(aboard);
+  free(aboard->changes.cells);
+  aboard->changes.cells = NULL;
+  aboard->changes.count = 0;
+  aboard->changes.capacity = 0;
+}
+
+// Additionally keep the occupation of the board in a packed bitmap.
+// Used by clients that need batch queries on rows or rectangles.
+enum ResCodes enableBoardBitmap(struct board* aboard) {
+  int nrows = aboard->last_row + 1;
+  int ncols = aboard->last_col + 1;
+  int y, x;
+
+  if (aboard->bitmap.words != NULL) {
+    return RES_OK; // Already enabled
+  }
+  if (initializeBitmap(&aboard->bitmap, nrows, ncols) != RES_OK) {
+    return RES_FAILED;
+  }
+  // Copy the current occupation
+  for (y = 0; y < nrows; y++) {
+    for (x = 0; x < ncols; x++) {
+      if (aboard->cells[y * ncols + x] != BC_FREE_CELL) {
+        setBit(&aboard->bitmap, y, x);
+      }
+    }
+  }
+  return RES_OK;
+}
+
+// Additionally keep the set of free cells.
+// Used by clients that place items on random free cells.
+enum ResCodes enableFreeCells(struct board* aboard) {
+  size_t ncells = (size_t)(aboard->last_row + 1) * (aboard->last_col + 1);
+  size_t i;
+
+  if (aboard->free.cells != NULL) {
+    return RES_OK; // Already enabled
+  }
+  if (ncells > INT_MAX) {
+    return RES_FAILED; // The set holds the index of a cell in an int
+  }
+  aboard->free.cells = malloc(ncells * sizeof(int));
+  aboard->free.slots = malloc(ncells * sizeof(int));
+  if (aboard->free.cells == NULL || aboard->free.slots == NULL) {
+    cleanupFreeCells(aboard);
+    return RES_FAILED;
+  }
+  // Collect the currently free cells
+  aboard->free.count = 0;
+  for (i = 0; i < ncells; i++) {
+    if (aboard->cells[i] == BC_FREE_CELL) {
+      aboard->free.slots[i] = aboard->free.count;
+      aboard->free.cells[aboard->free.count++] = (int)i;
+    }
+  }
+  return RES_OK;
+}
+
+// Index of a look in the board's table of looks; new looks are added.
+// There are only a handful of different looks, a linear search is fine.
+static unsigned char lookIndex(struct board* aboard, chtype symbol,
+                               enum ColorPairs color_pair) {
+  int i;
+
+  for (i = 0; i < aboard->nlooks; i++) {
+    if (aboard->look_table[i].symbol == symbol &&
+        aboard->look_table[i].color_pair == color_pair) {
+      return i;
+    }
+  }
+  if (aboard->nlooks == MAX_LOOKS) {
+    return 0; // Table full: such cells are redrawn as free cells
+  }
+  aboard->look_table[i].symbol = symbol;
+  aboard->look_table[i].color_pair = color_pair;
+  aboard->nlooks++;
+  return i;
+}
+
+// Store an item on the board.
+// The occupation and look of the cell are updated immediately. The symbol
+// is also recorded in the list of changes; it is put onto a display when
+// the changes are rendered (see display.c).
+void placeItem(struct board* aboard, int y, int x,
+               enum BoardCodes board_code, chtype symbol,
+               enum ColorPairs color_pair) {
+  struct change_list* changes = &aboard->changes;
+  struct cell_change* cell;
+
+  setContentAt(aboard, y, x, board_code);
+  aboard->looks[y * (aboard->last_col + 1) + x] =
+      lookIndex(aboard, symbol, color_pair);
+
+  if (changes->count == changes->capacity) {
+    // Grow the list; this only happens during the first few ticks
+    int capacity = 2 * changes->capacity;
+    struct cell_change* cells =
+        realloc(changes->cells, capacity * sizeof(struct cell_change));
+    if (cells == NULL) {
+      return; // Out of memory: the change is lost for the display only
+    }
+    changes->cells = cells;
+    changes->capacity = capacity;
+  }
+  cell = &changes->cells[changes->count++];
+  cell->y = y;
+  cell->x = x;
+  cell->symbol = symbol;
+  cell->color_pair = color_pair;
+}
+
+// Get the look of the cell at (y,x), e.g. for redrawing it
+struct look getLookAt(struct board* aboard, int y, int x) {
+  return aboard->look_table[aboard->looks[y * (aboard->last_col + 1) + x]];
+}
+
+// Set the occupation of a cell without showing anything
+void setContentAt(struct board* aboard, int y, int x,
+                  enum BoardCodes board_code) {
+  int index = y * (aboard->last_col + 1) + x;
+  bool was_free = aboard->cells[index] == BC_FREE_CELL;
+
+  aboard->cells[index] = board_code;
+  if (aboard->free.cells != NULL && was_free != (board_code == BC_FREE_CELL)) {
+    struct free_cells* afree = &aboard->free;
+    if (was_free) {
+      // Swap-remove: the last free cell takes the place of this one
+      int last = afree->cells[--afree->count];
+      afree->cells[afree->slots[index]] = last;
+      afree->slots[last] = afree->slots[index];
+    } else {
+      afree->slots[index] = afree->count;
+      afree->cells[afree->count++] = index;
+    }
+  }
+  if (aboard->bitmap.words != NULL) {
+    if (board_code == BC_FREE_CELL) {
+      clearBit(&aboard->bitmap, y, x);
+    } else {
+      setBit(&aboard->bitmap, y, x);
+    }
+  }
+}
+
+// Forget all recorded changes (e.g. after they have been displayed)
+void clearChanges(struct board* aboard) { aboard->changes.count = 0; }
+
 // Getters
 
-// Get the last usable row on the display
-int getLastRow() { return LINES - 1; }
+// Get the content of the cell at (y,x)
+enum BoardCodes getContentAt(struct board* aboard, int y, int x) {
+  return aboard->cells[y * (aboard->last_col + 1) + x];
+}
+
+// Number of free cells on the board
+int countFreeCells(struct board* aboard) { return aboard->free.count; }
+
+// Pick one of the free cells with equal probability, in constant time.
+// Returns false if the board is full.
+bool randomFreeCell(struct board* aboard, struct rng* arng,
+                    struct pos* apos) {
+  int ncols = aboard->last_col + 1;
+  int index;
+
+  if (aboard->free.count == 0) {
+    return false;
+  }
+  index = aboard->free.cells[randomBelow(arng, aboard->free.count)];
+  apos->y = index / ncols;
+  apos->x = index % ncols;
+  return true;
+}
+
+// Is (y,x) a cell of the board?
+bool isInsideBoard(struct board* aboard, int y, int x) {
+  return y >= 0 && y <= aboard->last_row && x >= 0 && x <= aboard->last_col;
+}
+
+// Get the last usable row on the board
+int getLastRow(struct board* aboard) { return aboard->last_row; }
+
+// Get the last usable column on the board
+int getLastCol(struct board* aboard) { return aboard->last_col; }
+
+// ************************************
+// Saving and loading
+// ************************************
 
-// Get the last usable column on the display
-int getLastCol() { return COLS - 1; }
+// Append the cells and their looks to abuf
+void saveBoard(struct board* aboard, struct state_buffer* abuf) {
+  size_t ncells = (size_t)(aboard->last_row + 1) * (aboard->last_col + 1);
+  int i;
+
+  putUint32(abuf, aboard->last_row + 1);
+  putUint32(abuf, aboard->last_col + 1);
+  putUint8(abuf, aboard->nlooks);
+  for (i = 0; i < aboard->nlooks; i++) {
+    putUint64(abuf, aboard->look_table[i].symbol);
+    putUint8(abuf, aboard->look_table[i].color_pair);
+  }
+  putBytes(abuf, aboard->cells, ncells);
+  putBytes(abuf, aboard->looks, ncells);
+}
+
+// Replace the cells and their looks by those saved in abuf.
+// The saved board must have the same size as aboard.
+// Pending changes are dropped; the caller redraws the whole board.
+// On failure the board is in an undefined state and must be cleaned up.
+enum ResCodes loadBoard(struct board* aboard, struct state_buffer* abuf) {
+  size_t ncells = (size_t)(aboard->last_row + 1) * (aboard->last_col + 1);
+  size_t c;
+  int nlooks;
+  int i;
+
+  if (getUint32(abuf) != (uint32_t)(aboard->last_row + 1) ||
+      getUint32(abuf) != (uint32_t)(aboard->last_col + 1)) {
+    return RES_FAILED;
+  }
+  nlooks = getUint8(abuf);
+  if (nlooks < 1 || nlooks > MAX_LOOKS) {
+    return RES_FAILED;
+  }
+  aboard->nlooks = nlooks;
+  for (i = 0; i < nlooks; i++) {
+    aboard->look_table[i].symbol = (chtype)getUint64(abuf);
+    aboard->look_table[i].color_pair = (enum ColorPairs)getUint8(abuf);
+  }
+  getBytes(abuf, aboard->cells, ncells);
+  getBytes(abuf, aboard->looks, ncells);
+  if (abuf->failed) {
+    return RES_FAILED;
+  }
+  // Only known codes and saved looks: the data may come from a torn file
+  for (c = 0; c < ncells; c++) {
+    if (aboard->cells[c] > BC_USED_BY_WORM || aboard->looks[c] >= nlooks) {
+      return RES_FAILED;
+    }
+  }
+  // Build the packed bitmap and the set of free cells anew from the cells
+  if (aboard->bitmap.words != NULL) {
+    cleanupBitmap(&aboard->bitmap);
+    if (enableBoardBitmap(aboard) != RES_OK) {
+      return RES_FAILED;
+    }
+  }
+  if (aboard->free.cells != NULL) {
+    cleanupFreeCells(aboard);
+    if (enableFreeCells(aboard) != RES_OK) {
+      return RES_FAILED;
+    }
+  }
+  clearChanges(aboard);
+  return RES_OK;
+}
@@ -12,13 +12,95 @@
 #ifndef _BOARD_MODEL_H
 #define _BOARD_MODEL_H
 #include <curses.h>
+#include <stdbool.h>
 #include "worm.h"
+#include "board_bitmap.h"
+#include "rng.h"
+#include "state_buffer.h"
+
+// A single cell of the board that changed during the current tick
+struct cell_change {
+  int y;
+  int x;
+  chtype symbol;
+  enum ColorPairs color_pair;
+};
+
+// The list of cells changed during the current tick
+struct change_list {
+  struct cell_change* cells; // Array of changed cells
+  int count;                 // Number of used elements in cells
+  int capacity;              // Number of allocated elements in cells
+};
+
+// How a cell looks on a display
+struct look {
+  chtype symbol;
+  enum ColorPairs color_pair;
+};
+
+#define MAX_LOOKS 32 // Maximal number of different looks of cells
+
+// The free cells of the board as an indexable set.
+// A dense array holds the index (y * ncols + x) of every free cell in no
+// particular order; a map tells the position of each free cell in that
+// array. Occupying a cell moves the last element into its place, freeing
+// a cell appends it. Thus both take constant time, and so does picking a
+// free cell at random, however full the board is.
+struct free_cells {
+  int* cells; // Indices of all free cells; NULL if the set is not in use
+  int* slots; // Per cell: its position in cells; only valid if it is free
+  int count;  // Number of free cells
+};
+
+// The board: dimensions, occupation and look of each cell and the changes
+// not yet shown on any display.
+// The board may be larger than the display; a display shows a part of it.
+// The board model does not call curses; a display renders the changes.
+struct board {
+  int last_row; // Last usable row of the board
+  int last_col; // Last usable column of the board
+  unsigned char* cells; // Content of all cells (enum BoardCodes), row by row
+  unsigned char* looks; // Look of all cells: index into look_table
+  struct look look_table[MAX_LOOKS]; // All looks used so far; 0: free cell
+  int nlooks;                        // Number of used entries in look_table
+  struct bitmap bitmap; // Optional packed occupancy; words == NULL if off
+  struct free_cells free; // Optional set of free cells; cells == NULL if off
+  struct change_list changes;
+};
+
+// Initialization and cleanup of the board
+extern enum ResCodes initializeBoard(struct board* aboard, int nrows,
+                                     int ncols);
+extern void cleanupBoard(struct board* aboard);
+extern enum ResCodes enableBoardBitmap(struct board* aboard);
+extern enum ResCodes enableFreeCells(struct board* aboard);
+
 // Placing and removing items from the game board
-// Check boundaries of game board
+extern void placeItem(struct board* aboard, int y, int x,
+                      enum BoardCodes board_code, chtype symbol,
+                      enum ColorPairs color_pair);
+extern void clearChanges(struct board* aboard);
 
-extern void placeItem(int y, int x, chtype symbol, enum ColorPairs color_pair);
-extern int getLastRow();
-extern int getLastCol();
+// Content of a cell; (y,x) must be within the boundaries of the board
+extern enum BoardCodes getContentAt(struct board* aboard, int y, int x);
+extern void setContentAt(struct board* aboard, int y, int x,
+                         enum BoardCodes board_code);
+extern struct look getLookAt(struct board* aboard, int y, int x);
+
+// The free cells; the set must have been enabled
+extern int countFreeCells(struct board* aboard);
+extern bool randomFreeCell(struct board* aboard, struct rng* arng,
+                           struct pos* apos);
+
+// Check boundaries of game board
+extern bool isInsideBoard(struct board* aboard, int y, int x);
+extern int getLastRow(struct board* aboard);
+extern int getLastCol(struct board* aboard);
 
+// Saving and loading the occupation and looks of all cells
+extern void saveBoard(struct board* aboard, struct state_buffer* abuf);
+extern enum ResCodes loadBoard(struct board* aboard,
+                               struct state_buffer* abuf);
 
 #endif  // #define _BOARD_MODEL_H
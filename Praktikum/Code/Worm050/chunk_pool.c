@@ -0,0 +1,84 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A pool of fixed size chunks for the bodies of the worms
+
+#include <stdlib.h>
+
+#include "chunk_pool.h"
+#include "worm.h"
+
+#define MIN_SLAB_CHUNKS 64 // Smallest number of chunks in a slab
+
+// Allocate a slab of nchunks chunks and put them into the free list
+static enum ResCodes addSlab(struct chunk_pool* apool, long nchunks) {
+  struct chunk_slab* slab;
+  long i;
+
+  slab = malloc(sizeof(struct chunk_slab) +
+                nchunks * sizeof(struct body_chunk));
+  if (slab == NULL) {
+    return RES_FAILED;
+  }
+  slab->nchunks = (int)nchunks;
+  slab->next = apool->slabs;
+  apool->slabs = slab;
+
+  for (i = 0; i < nchunks; i++) {
+    slab->chunks[i].next = apool->free_list;
+    apool->free_list = &slab->chunks[i];
+  }
+  apool->nchunks += nchunks;
+  apool->nfree += nchunks;
+  return RES_OK;
+}
+
+// Set up a pool with room for nchunks chunks
+enum ResCodes initializeChunkPool(struct chunk_pool* apool, long nchunks) {
+  apool->free_list = NULL;
+  apool->slabs = NULL;
+  apool->nchunks = 0;
+  apool->nfree = 0;
+  return addSlab(apool, nchunks < MIN_SLAB_CHUNKS ? MIN_SLAB_CHUNKS : nchunks);
+}
+
+// Free all slabs; all chunks become invalid
+void cleanupChunkPool(struct chunk_pool* apool) {
+  while (apool->slabs != NULL) {
+    struct chunk_slab* slab = apool->slabs;
+    apool->slabs = slab->next;
+    free(slab);
+  }
+  apool->free_list = NULL;
+  apool->nchunks = 0;
+  apool->nfree = 0;
+}
+
+// Take a chunk from the pool.
+// If the pool is empty, it grows by as many chunks as it already has.
+// Returns NULL if we are out of memory.
+struct body_chunk* allocChunk(struct chunk_pool* apool) {
+  struct body_chunk* chunk;
+
+  if (apool->free_list == NULL && addSlab(apool, apool->nchunks) != RES_OK) {
+    return NULL;
+  }
+  chunk = apool->free_list;
+  apool->free_list = chunk->next;
+  apool->nfree--;
+  chunk->next = NULL;
+  return chunk;
+}
+
+// Give a chunk back to the pool
+void releaseChunk(struct chunk_pool* apool, struct body_chunk* chunk) {
+  chunk->next = apool->free_list;
+  apool->free_list = chunk;
+  apool->nfree++;
+}
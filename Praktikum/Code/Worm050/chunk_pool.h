@@ -0,0 +1,49 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A pool of fixed size chunks for the bodies of the worms.
+//
+// The body of a worm is a chain of chunks. A growing worm takes another
+// chunk from the pool; the existing body is never copied. Chunks are
+// allocated in slabs of increasing size, so malloc is called only a
+// logarithmic number of times, never per chunk.
+
+#ifndef _CHUNK_POOL_H
+#define _CHUNK_POOL_H
+
+#include "worm.h"
+
+#define CHUNK_LENGTH 32 // Number of positions in a chunk
+
+struct body_chunk {
+  struct body_chunk* next; // Next chunk towards the head; free list link
+  struct pos elems[CHUNK_LENGTH];
+};
+
+// A block of chunks obtained by a single malloc
+struct chunk_slab {
+  struct chunk_slab* next;
+  int nchunks;
+  struct body_chunk chunks[];
+};
+
+struct chunk_pool {
+  struct body_chunk* free_list; // Chunks available for allocation
+  struct chunk_slab* slabs;     // All slabs, for freeing them at the end
+  long nchunks;                 // Total number of chunks in all slabs
+  long nfree;                   // Number of chunks in the free list
+};
+
+extern enum ResCodes initializeChunkPool(struct chunk_pool* apool,
+                                         long nchunks);
+extern void cleanupChunkPool(struct chunk_pool* apool);
+extern struct body_chunk* allocChunk(struct chunk_pool* apool);
+extern void releaseChunk(struct chunk_pool* apool, struct body_chunk* chunk);
+
+#endif  // #define _CHUNK_POOL_H
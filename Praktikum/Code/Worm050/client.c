@@ -0,0 +1,465 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The worm client: plays a worm on a worm server (see server.c)
+//
+// The client keeps a copy of the board. It knows nothing about the worms:
+// it only applies the cells the server sends and shows the changes of
+// each tick, like the local game does after stepGame. The direction keys
+// go to the server at once; all keys read in one go share a single write.
+
+#define _GNU_SOURCE // For ppoll
+#include <curses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "worm.h"
+#include "board_model.h"
+#include "display.h"
+#include "messages.h"
+#include "prep.h"
+#include "state_buffer.h"
+#include "wire.h"
+#include "worm_model.h"
+
+#define CLIENT_READ_SIZE 65536 // Bytes read from the server at once
+
+// Settings from the command line
+struct options {
+  char* socket_path;            // Where the server listens
+  enum RenderBackends renderer; // How the frames get to the terminal
+};
+
+// Everything the client knows about the game
+struct client {
+  int fd;                   // The connection to the server
+  struct state_buffer in;   // Bytes received, not processed yet
+  struct state_buffer out;  // Heading changes to be sent
+  struct board board;       // Copy of the server's board
+  bool welcomed;            // The board has been set up
+  int id;                   // Id of our worm on the server
+  long tick;                // Tick of the last status
+  struct wire_status status; // Our worm as of the last tick
+  bool rejected;            // The server has no room for us
+  bool quit;                // The user wants to leave
+};
+
+int connectToServer(char* path);
+void readUserInput(struct client* aclient);
+void showEndOfGame(struct client* aclient);
+void showClientStatus(struct client* aclient);
+enum ResCodes processMessage(struct client* aclient,
+                             struct state_buffer* amsg);
+enum ResCodes receiveMessages(struct client* aclient);
+enum ResCodes sendHeadings(struct client* aclient);
+enum ResCodes doClient(int fd);
+void printUsage(char* progname);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
+
+// Returns the connected socket or -1
+int connectToServer(char* path) {
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// ************************************
+// Keys
+// ************************************
+
+// Process all keys the user has pressed since the last call.
+// Direction keys are collected in aclient->out for a single write.
+// While a modal dialog is open, any key ends the client.
+void readUserInput(struct client* aclient) {
+  int ch; // For storing the key codes
+
+  while ((ch = getch()) != ERR) {
+    if (isDialogModal()) {
+      aclient->quit = true;
+      return;
+    }
+    switch (ch) {
+    case 'q': // User wants to end the show
+      aclient->quit = true;
+      return;
+    case KEY_UP: // User wants up
+      putWireHeader(&aclient->out, WIRE_HEADING, WORM_UP, 0, aclient->tick);
+      break;
+    case KEY_DOWN: // User wants down
+      putWireHeader(&aclient->out, WIRE_HEADING, WORM_DOWN, 0,
+                    aclient->tick);
+      break;
+    case KEY_LEFT: // User wants left
+      putWireHeader(&aclient->out, WIRE_HEADING, WORM_LEFT, 0,
+                    aclient->tick);
+      break;
+    case KEY_RIGHT: // User wants right
+      putWireHeader(&aclient->out, WIRE_HEADING, WORM_RIGHT, 0,
+                    aclient->tick);
+      break;
+    }
+  }
+}
+
+// Send the collected heading changes.
+// The few bytes fit into the socket buffer; a short write means the
+// server does not read anymore.
+enum ResCodes sendHeadings(struct client* aclient) {
+  ssize_t n;
+
+  if (aclient->out.size == 0) {
+    return RES_OK;
+  }
+  n = write(aclient->fd, aclient->out.data, aclient->out.size);
+  clearStateBuffer(&aclient->out);
+  return n > 0 ? RES_OK : RES_FAILED;
+}
+
+// ************************************
+// Messages of the server
+// ************************************
+
+// Tell the user why our worm is gone by a modal dialog
+void showEndOfGame(struct client* aclient) {
+  switch (aclient->status.state) {
+  case WORM_OUT_OF_BOUNDS:
+    openDialog(&aclient->board, DIALOG_MODAL,
+               "Sie haben das Spiel verloren,"
+               " weil Sie das Spielfeld verlassen haben",
+               "Bitte Taste druecken");
+    break;
+  case WORM_CROSSING:
+    openDialog(&aclient->board, DIALOG_MODAL,
+               "Sie haben das Spiel verloren,"
+               " weil Sie einen Wurm gekreuzt haben",
+               "Bitte Taste druecken");
+    break;
+  default:
+    openDialog(&aclient->board, DIALOG_MODAL, "Ihr Wurm wurde beendet",
+               "Bitte Taste druecken");
+  }
+}
+
+// Display the status of our worm in the message area
+void showClientStatus(struct client* aclient) {
+  int pos_line2 = getLayout()->message_row + 2;
+  char text[80];
+
+  snprintf(text, sizeof(text),
+           "Wurm %d ist an Position: y=%3d x=%3d Laenge %ld Tick %ld",
+           aclient->id, aclient->status.headpos.y, aclient->status.headpos.x,
+           aclient->status.length, aclient->tick);
+  queueString(pos_line2, 1, text, COLP_MESSAGE);
+}
+
+// Apply one complete message.
+// Returns RES_FAILED if the server has sent nonsense.
+enum ResCodes processMessage(struct client* aclient,
+                             struct state_buffer* amsg) {
+  struct wire_header header;
+  struct wire_welcome welcome;
+  struct cell_change cell;
+  enum GameStates old_state;
+  int i;
+
+  getWireHeader(amsg, &header);
+  switch (header.type) {
+  case WIRE_WELCOME:
+    getWireWelcome(amsg, &welcome);
+    if (aclient->welcomed ||
+        welcome.nrows < MIN_NUMBER_OF_ROWS ||
+        welcome.ncols < MIN_NUMBER_OF_COLS ||
+        initializeBoard(&aclient->board, welcome.nrows, welcome.ncols) !=
+            RES_OK) {
+      return RES_FAILED;
+    }
+    aclient->welcomed = true;
+    aclient->id = welcome.id;
+    setViewport(&aclient->board, getLayout()->board_rows,
+                getLayout()->ncols);
+    clearLineInMessageArea(getLayout()->message_row + 1); // No more waiting
+    return RES_OK;
+  case WIRE_CELLS:
+    if (!aclient->welcomed) {
+      return RES_FAILED;
+    }
+    for (i = 0; i < header.count; i++) {
+      getWireCell(amsg, &cell);
+      if (!isInsideBoard(&aclient->board, cell.y, cell.x)) {
+        return RES_FAILED;
+      }
+      placeItem(&aclient->board, cell.y, cell.x,
+                cell.symbol == SYMBOL_FREE_CELL ? BC_FREE_CELL
+                                                : BC_USED_BY_WORM,
+                cell.symbol, cell.color_pair);
+    }
+    return RES_OK;
+  case WIRE_STATUS:
+    if (!aclient->welcomed) {
+      return RES_FAILED;
+    }
+    old_state = aclient->status.state;
+    aclient->status.state = (enum GameStates)header.arg;
+    getWireStatus(amsg, &aclient->status);
+    aclient->tick = header.tick;
+
+    // The tick is complete: show its changes.
+    // If the viewport has to follow our worm, redraw all of it.
+    if (aclient->status.state == WORM_GAME_ONGOING &&
+        followPos(aclient->status.headpos.y, aclient->status.headpos.x)) {
+      drawViewport(&aclient->board);
+    } else {
+      drawChanges(&aclient->board.changes);
+    }
+    clearChanges(&aclient->board);
+    if (old_state == WORM_GAME_ONGOING &&
+        aclient->status.state != WORM_GAME_ONGOING) {
+      showEndOfGame(aclient);
+    }
+    tickDialog(&aclient->board);
+    drawDialog();
+    showClientStatus(aclient);
+    showRenderStatus();
+    flushFrame();
+    presentFrame();
+    return RES_OK;
+  case WIRE_REJECT:
+    // The server closes the connection; the dialog stays until a key
+    aclient->rejected = true;
+    openDialog(&aclient->board, DIALOG_MODAL,
+               "Der Server hat keinen Platz fuer einen weiteren Wurm",
+               "Bitte Taste druecken");
+    flushFrame();
+    presentFrame();
+    return RES_OK;
+  default:
+    return RES_FAILED;
+  }
+}
+
+// Read what the server has sent and process all complete messages.
+// Returns RES_FAILED if the connection is gone.
+enum ResCodes receiveMessages(struct client* aclient) {
+  struct state_buffer* ain = &aclient->in;
+  unsigned char data[CLIENT_READ_SIZE];
+  struct state_buffer msg;
+  size_t pos = 0;
+  ssize_t n;
+  long size;
+
+  while ((n = read(aclient->fd, data, sizeof(data))) > 0) {
+    putBytes(ain, data, n);
+  }
+  if (ain->failed ||
+      (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    return RES_FAILED;
+  }
+  while ((size = wireMessageSize(ain->data + pos, ain->size - pos)) > 0 &&
+         (size_t)size <= ain->size - pos) {
+    viewStateBuffer(&msg, ain->data + pos, size);
+    if (processMessage(aclient, &msg) != RES_OK) {
+      return RES_FAILED;
+    }
+    pos += size;
+  }
+  if (size < 0) {
+    return RES_FAILED; // Unknown message
+  }
+  // Keep the incomplete rest for the next call
+  memmove(ain->data, ain->data + pos, ain->size - pos);
+  ain->size -= pos;
+  // n == 0: the server has closed the connection.
+  // After a rejection that is expected; the dialog is still open.
+  return n == 0 && !aclient->rejected ? RES_FAILED : RES_OK;
+}
+
+// ************************************
+// The main loop
+// ************************************
+
+enum ResCodes doClient(int fd) {
+  struct client theclient;
+  struct pollfd pfds[2];
+  sigset_t wait_mask; // SIGWINCH is only let in while we wait
+  enum ResCodes res_code = RES_OK;
+  int res;
+
+  memset(&theclient, 0, sizeof(theclient));
+  theclient.fd = fd;
+  theclient.status.state = WORM_GAME_ONGOING;
+  if (initializeStateBuffer(&theclient.in, CLIENT_READ_SIZE) != RES_OK ||
+      initializeStateBuffer(&theclient.out, 64) != RES_OK) {
+    cleanupStateBuffer(&theclient.in);
+    return RES_FAILED;
+  }
+  showBorderLine();
+  showNotice("Warte auf den Server");
+  flushFrame();
+  presentFrame();
+
+  pfds[0].fd = STDIN_FILENO;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = fd;
+  pfds[1].events = POLLIN;
+  pthread_sigmask(SIG_BLOCK, NULL, &wait_mask);
+  sigdelset(&wait_mask, SIGWINCH);
+  while (!theclient.quit) {
+#ifdef __linux__
+    res = ppoll(pfds, 2, NULL, &wait_mask);
+#else
+    {
+      sigset_t old_mask;
+      pthread_sigmask(SIG_SETMASK, &wait_mask, &old_mask);
+      res = poll(pfds, 2, -1);
+      pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    }
+#endif
+    if (res < 0 && errno != EINTR) {
+      res_code = RES_FAILED;
+      break;
+    }
+    // The window may have changed its size
+    if (theclient.welcomed && resizeDisplay(&theclient.board)) {
+      relayoutDialog(&theclient.board);
+      relayoutMessageArea();
+      showClientStatus(&theclient);
+      drawDialog();
+      flushFrame();
+      presentFrame();
+    }
+    if (res < 0) {
+      continue;
+    }
+    if (pfds[0].revents & POLLIN) {
+      readUserInput(&theclient);
+      if (sendHeadings(&theclient) != RES_OK) {
+        res_code = RES_FAILED;
+        break;
+      }
+    }
+    if ((pfds[1].revents & (POLLIN | POLLHUP | POLLERR)) &&
+        receiveMessages(&theclient) != RES_OK) {
+      res_code = RES_FAILED;
+      break;
+    }
+    if (theclient.rejected) {
+      pfds[1].fd = -1; // Nothing more to come; poll skips it
+    }
+  }
+
+  cleanupStateBuffer(&theclient.in);
+  cleanupStateBuffer(&theclient.out);
+  cleanupBoard(&theclient.board);
+  return theclient.rejected ? RES_FAILED : res_code;
+}
+
+// ********************************************************************************************
+// MAIN
+// ********************************************************************************************
+
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr, "Aufruf: %s [--socket PFAD] [--renderer curses|ansi]\n",
+          progname);
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  int i;
+
+  // Defaults
+  opts->socket_path = WIRE_SOCKET_PATH;
+  opts->renderer = RENDER_CURSES;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return RES_FAILED; // All options have an argument
+    }
+    if (strcmp(argv[i], "--socket") == 0) {
+      opts->socket_path = argv[i + 1];
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "curses") == 0) {
+      opts->renderer = RENDER_CURSES;
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "ansi") == 0) {
+      opts->renderer = RENDER_ANSI;
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
+  enum ResCodes res_code; // Result code from functions
+  struct options opts;    // Settings from the command line
+  int fd;
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+  fd = connectToServer(opts.socket_path);
+  if (fd < 0) {
+    fprintf(stderr, "Kein Server auf %s\n", opts.socket_path);
+    return RES_FAILED;
+  }
+
+  // Here we start
+  initializeCursesApplication(); // Init various settings of our application
+  if (LINES < ROWS_RESERVED + MIN_NUMBER_OF_ROWS ||
+      COLS < MIN_NUMBER_OF_COLS) {
+    cleanupCursesApp();
+    printf("Das Fenster ist zu klein: wir brauchen mindestens %dx%d\n",
+           MIN_NUMBER_OF_COLS, MIN_NUMBER_OF_ROWS + ROWS_RESERVED);
+    res_code = RES_FAILED;
+  } else if (initializeDisplay(opts.renderer) != RES_OK) {
+    cleanupCursesApp();
+    res_code = RES_FAILED;
+  } else {
+    res_code = doClient(fd);
+    cleanupDisplay();
+    cleanupCursesApp();
+    if (res_code != RES_OK) {
+      printf("Die Verbindung zum Server ist beendet\n");
+    }
+  }
+  close(fd);
+  return res_code;
+}
@@ -0,0 +1,404 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Rendering of board changes on the curses display
+
+#include <curses.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "ansi_display.h"
+#include "board_model.h"
+#include "display.h"
+#include "worm.h"
+
+// Initial number of cells in the frame queue
+#define INITIAL_FRAME_CAPACITY 256
+// The viewport is moved if the followed position gets closer than
+// 1/VIEWPORT_MARGIN of its size to an edge
+#define VIEWPORT_MARGIN 8
+
+// A queued cell of the current frame
+struct queued_cell {
+  int y;
+  int x;
+  int seq;      // Order of queueing; the last write to a cell wins
+  chtype cell;  // Symbol including the color pair attribute
+};
+
+// The frame queue. There is only one curses screen, thus a single queue.
+static struct queued_cell* frame_cells = NULL;
+static int frame_count = 0;
+static int frame_capacity = 0;
+
+// The part of the board shown in the upper part of the window.
+// Board cell (top + i, left + j) is shown at window position (i, j).
+static struct {
+  int top;
+  int left;
+  int nrows;      // Number of board rows shown
+  int ncols;      // Number of board columns shown
+  int board_rows; // Size of the whole board
+  int board_cols;
+} viewport;
+
+// The layout of the window; computed at the start and after resizing
+static struct screen_layout layout;
+
+// Set by the handler of SIGWINCH; the resize is done by resizeDisplay
+static volatile sig_atomic_t resize_pending = 0;
+
+// Buffer for a single run of cells passed to the backend
+static chtype* run_buffer = NULL;
+static int run_capacity = 0;
+
+// ************************************
+// The curses backend
+// ************************************
+
+static enum ResCodes initializeCursesBackend(void) {
+  return RES_OK;
+}
+
+static void cleanupCursesBackend(void) {
+}
+
+static void writeCursesRun(int y, int x, const chtype* cells, int len) {
+  mvaddchnstr(y, x, cells, len);
+}
+
+static void presentCurses(void) {
+  refresh();
+}
+
+static void resizeCurses(int nrows, int ncols) {
+  // resizeterm has resized stdscr; curses repaints the terminal
+}
+
+static const struct render_backend curses_backend = {
+    initializeCursesBackend, cleanupCursesBackend, writeCursesRun,
+    presentCurses, NULL, resizeCurses};
+
+// The backend in use
+static const struct render_backend* backend = &curses_backend;
+
+// ************************************
+// The layout of the window
+// ************************************
+
+static void computeLayout(int nrows, int ncols) {
+  layout.nrows = nrows;
+  layout.ncols = ncols;
+  layout.board_rows = nrows > ROWS_RESERVED ? nrows - ROWS_RESERVED : 0;
+  layout.message_row = nrows - ROWS_RESERVED;
+}
+
+static void handleResizeSignal(int signum) {
+  resize_pending = 1;
+}
+
+const struct screen_layout* getLayout() {
+  return &layout;
+}
+
+// Adapt the display to a new size of the window, if a SIGWINCH has come.
+// The message area moves to the new bottom; the caller has to show it
+// again. Of the board only the cells that have become visible are
+// queued, or the whole viewport if it had to move.
+// Returns true if the layout has changed.
+bool resizeDisplay(struct board* aboard) {
+  struct screen_layout old = layout;
+  struct winsize size;
+  int rows;
+
+  if (!resize_pending) {
+    return false;
+  }
+  resize_pending = 0;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 ||
+      (size.ws_row == old.nrows && size.ws_col == old.ncols)) {
+    return false;
+  }
+  resizeterm(size.ws_row, size.ws_col);
+  computeLayout(size.ws_row, size.ws_col);
+  backend->resize(layout.nrows, layout.ncols);
+
+  if (resizeViewport(layout.board_rows, layout.ncols)) {
+    drawViewport(aboard);
+    return true;
+  }
+  // Rows that were the message area before or beyond the window
+  if (layout.board_rows > old.board_rows) {
+    drawViewportArea(aboard, old.board_rows, 0,
+                     layout.board_rows - old.board_rows, layout.ncols);
+  }
+  // Columns beyond the window in the rows that were visible before
+  rows = old.board_rows < layout.board_rows ? old.board_rows
+                                            : layout.board_rows;
+  if (layout.ncols > old.ncols) {
+    drawViewportArea(aboard, 0, old.ncols, rows, layout.ncols - old.ncols);
+  }
+  return true;
+}
+
+// ************************************
+// The frame queue
+// ************************************
+
+enum ResCodes initializeDisplay(enum RenderBackends which) {
+  struct sigaction action;
+  sigset_t winch;
+
+  computeLayout(LINES, COLS);
+  backend = which == RENDER_ANSI ? &ansi_backend : &curses_backend;
+  if (backend->initialize() != RES_OK) {
+    return RES_FAILED;
+  }
+  frame_cells = malloc(INITIAL_FRAME_CAPACITY * sizeof(struct queued_cell));
+  if (frame_cells == NULL) {
+    backend->cleanup();
+    return RES_FAILED;
+  }
+  frame_capacity = INITIAL_FRAME_CAPACITY;
+  frame_count = 0;
+
+  // Replaces the handler of curses; we resize curses ourselves
+  action.sa_handler = handleResizeSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGWINCH, &action, NULL);
+  // The signal stays pending until the main loop waits (see scheduler.c).
+  // Threads started later inherit the mask and never see it.
+  sigemptyset(&winch);
+  sigaddset(&winch, SIGWINCH);
+  pthread_sigmask(SIG_BLOCK, &winch, NULL);
+  return RES_OK;
+}
+
+void cleanupDisplay() {
+  backend->cleanup();
+  free(frame_cells);
+  free(run_buffer);
+  frame_cells = NULL;
+  run_buffer = NULL;
+  frame_count = frame_capacity = run_capacity = 0;
+}
+
+// Queue a single cell for the current frame
+void queueCell(int y, int x, chtype symbol, enum ColorPairs color_pair) {
+  struct queued_cell* qc;
+
+  if (frame_count == frame_capacity) {
+    int capacity = frame_capacity > 0 ? 2 * frame_capacity
+                                      : INITIAL_FRAME_CAPACITY;
+    struct queued_cell* cells =
+        realloc(frame_cells, capacity * sizeof(struct queued_cell));
+    if (cells == NULL) {
+      return; // Out of memory: the cell is not displayed
+    }
+    frame_cells = cells;
+    frame_capacity = capacity;
+  }
+  qc = &frame_cells[frame_count];
+  qc->y = y;
+  qc->x = x;
+  qc->seq = frame_count;
+  qc->cell = symbol | COLOR_PAIR(color_pair);
+  frame_count++;
+}
+
+// Queue a string starting at (y,x)
+void queueString(int y, int x, const char* text, enum ColorPairs color_pair) {
+  for (; *text != '\0'; text++, x++) {
+    queueCell(y, x, (unsigned char)*text, color_pair);
+  }
+}
+
+// Queue all cells changed on the board that are inside the viewport
+void drawChanges(const struct change_list* changes) {
+  int i;
+
+  for (i = 0; i < changes->count; i++) {
+    const struct cell_change* cell = &changes->cells[i];
+    int y = cell->y - viewport.top;
+    int x = cell->x - viewport.left;
+    if (y >= 0 && y < viewport.nrows && x >= 0 && x < viewport.ncols) {
+      queueCell(y, x, cell->symbol, cell->color_pair);
+    }
+  }
+}
+
+// Show the board in a window area of nrows x ncols cells.
+// If the board is smaller, the area is not used completely.
+void setViewport(struct board* aboard, int nrows, int ncols) {
+  viewport.board_rows = getLastRow(aboard) + 1;
+  viewport.board_cols = getLastCol(aboard) + 1;
+  viewport.nrows = nrows < viewport.board_rows ? nrows : viewport.board_rows;
+  viewport.ncols = ncols < viewport.board_cols ? ncols : viewport.board_cols;
+  viewport.top = 0;
+  viewport.left = 0;
+}
+
+// The area for the viewport has the new size nrows x ncols.
+// The viewport keeps its position as far as the board allows.
+// Returns true if it has moved; it must be redrawn then.
+bool resizeViewport(int nrows, int ncols) {
+  int top = viewport.top;
+  int left = viewport.left;
+
+  viewport.nrows = nrows < viewport.board_rows ? nrows : viewport.board_rows;
+  viewport.ncols = ncols < viewport.board_cols ? ncols : viewport.board_cols;
+  if (viewport.top + viewport.nrows > viewport.board_rows) {
+    viewport.top = viewport.board_rows - viewport.nrows;
+  }
+  if (viewport.left + viewport.ncols > viewport.board_cols) {
+    viewport.left = viewport.board_cols - viewport.ncols;
+  }
+  return viewport.top != top || viewport.left != left;
+}
+
+// New start of the viewport in one dimension so that pos is centered,
+// but without leaving the board
+static int centerOn(int pos, int size, int board_size) {
+  int start = pos - size / 2;
+  if (start > board_size - size) {
+    start = board_size - size;
+  }
+  return start < 0 ? 0 : start;
+}
+
+// Move the viewport if (y,x) gets close to one of its edges.
+// Returns true if the viewport has moved; it must be redrawn then.
+bool followPos(int y, int x) {
+  int margin_y = viewport.nrows / VIEWPORT_MARGIN;
+  int margin_x = viewport.ncols / VIEWPORT_MARGIN;
+  bool moved = false;
+
+  // Jump by half a screen instead of scrolling every tick;
+  // a full redraw is expensive
+  if ((y < viewport.top + margin_y && viewport.top > 0) ||
+      (y >= viewport.top + viewport.nrows - margin_y &&
+       viewport.top + viewport.nrows < viewport.board_rows) ||
+      y < viewport.top || y >= viewport.top + viewport.nrows) {
+    viewport.top = centerOn(y, viewport.nrows, viewport.board_rows);
+    moved = true;
+  }
+  if ((x < viewport.left + margin_x && viewport.left > 0) ||
+      (x >= viewport.left + viewport.ncols - margin_x &&
+       viewport.left + viewport.ncols < viewport.board_cols) ||
+      x < viewport.left || x >= viewport.left + viewport.ncols) {
+    viewport.left = centerOn(x, viewport.ncols, viewport.board_cols);
+    moved = true;
+  }
+  return moved;
+}
+
+// Queue the cells of the window area of nrows x ncols at (y,x) that
+// belong to the upper part of the window. Cells beyond the board are
+// cleared.
+void drawViewportArea(struct board* aboard, int y, int x, int nrows,
+                      int ncols) {
+  int i, j;
+
+  for (i = y; i < y + nrows; i++) {
+    for (j = x; j < x + ncols; j++) {
+      if (i >= 0 && i < viewport.nrows && j >= 0 && j < viewport.ncols) {
+        struct look look =
+            getLookAt(aboard, viewport.top + i, viewport.left + j);
+        queueCell(i, j, look.symbol, look.color_pair);
+      } else if (i >= 0 && j >= 0) {
+        queueCell(i, j, ' ', COLP_FREE_CELL);
+      }
+    }
+  }
+}
+
+// Queue all cells of the viewport
+void drawViewport(struct board* aboard) {
+  drawViewportArea(aboard, 0, 0, viewport.nrows, viewport.ncols);
+}
+
+// Order: row, column, order of queueing
+static int compareQueuedCells(const void* a, const void* b) {
+  const struct queued_cell* qa = a;
+  const struct queued_cell* qb = b;
+
+  if (qa->y != qb->y) {
+    return qa->y < qb->y ? -1 : 1;
+  }
+  if (qa->x != qb->x) {
+    return qa->x < qb->x ? -1 : 1;
+  }
+  return qa->seq < qb->seq ? -1 : (qa->seq > qb->seq);
+}
+
+// Pass the queued cells to the backend.
+// Cells are sorted by position; of several writes to the same cell only the
+// last one is kept. Each horizontal run of adjacent cells with the same
+// color pair is passed by one call of writeRun.
+void flushFrame() {
+  int i = 0;
+
+  if (frame_count == 0) {
+    return;
+  }
+  if (run_capacity < frame_count) {
+    chtype* buffer = realloc(run_buffer, frame_count * sizeof(chtype));
+    if (buffer == NULL) {
+      frame_count = 0;
+      return;
+    }
+    run_buffer = buffer;
+    run_capacity = frame_count;
+  }
+  qsort(frame_cells, frame_count, sizeof(struct queued_cell),
+        compareQueuedCells);
+
+  while (i < frame_count) {
+    int y, x0, len;
+    chtype color;
+
+    // The first cell of a run must be the last write to its position
+    while (i + 1 < frame_count && frame_cells[i + 1].y == frame_cells[i].y &&
+           frame_cells[i + 1].x == frame_cells[i].x) {
+      i++;
+    }
+    y = frame_cells[i].y;
+    x0 = frame_cells[i].x;
+    color = frame_cells[i].cell & A_COLOR;
+    len = 0;
+
+    for (; i < frame_count; i++) {
+      const struct queued_cell* qc = &frame_cells[i];
+      if (i + 1 < frame_count && frame_cells[i + 1].y == qc->y &&
+          frame_cells[i + 1].x == qc->x) {
+        continue; // Overwritten later in this frame
+      }
+      if (qc->y != y || qc->x != x0 + len || (qc->cell & A_COLOR) != color) {
+        break; // End of the current run
+      }
+      run_buffer[len++] = qc->cell;
+    }
+    backend->writeRun(y, x0, run_buffer, len);
+  }
+  frame_count = 0;
+}
+
+// Show the frame on the terminal
+void presentFrame() {
+  backend->present();
+}
+
+// Statistics of the output; NULL if the backend does not count
+const struct render_stats* getRenderStats() {
+  return backend->getStats != NULL ? backend->getStats() : NULL;
+}
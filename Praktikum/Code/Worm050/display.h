@@ -0,0 +1,97 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Rendering of board changes on the curses display
+//
+// All output of a frame is queued first. flushFrame() then writes each
+// horizontal run of cells with the same color pair by a single addchnstr.
+//
+// The board may be larger than the window. The upper part of the window
+// shows a viewport onto the board; changes outside the viewport are not
+// sent to curses at all.
+//
+// The layout of the window is cached in a struct. When the window changes
+// its size (SIGWINCH), the layout is computed again and only the parts
+// of the board that have become visible are drawn. initializeDisplay
+// blocks SIGWINCH before any thread is started; the main loop lets it in
+// only while it waits, and calls resizeDisplay in every iteration.
+//
+// The runs go to a render backend. The default backend passes them to
+// curses; the ANSI backend (see ansi_display.c) writes the terminal
+// itself. Curses is used for the keyboard with both backends.
+
+#ifndef _DISPLAY_H
+#define _DISPLAY_H
+
+#include <curses.h>
+#include <stdbool.h>
+#include "worm.h"
+#include "board_model.h"
+
+// The layout of the window
+struct screen_layout {
+  int nrows;       // Size of the window
+  int ncols;
+  int board_rows;  // Rows above the message area
+  int message_row; // First row of the message area (the border line)
+};
+
+// The available render backends
+enum RenderBackends {
+  RENDER_CURSES, // Runs are passed to curses
+  RENDER_ANSI,   // Own front and back buffers, ANSI sequences
+};
+
+// Output statistics of a backend that writes the terminal itself
+struct render_stats {
+  long frames;     // Frames presented
+  long bytes;      // Bytes written in total
+  long writes;     // Calls of write in total
+  long last_bytes; // Bytes of the last frame
+};
+
+// Where the runs of a frame go
+struct render_backend {
+  enum ResCodes (*initialize)(void);
+  void (*cleanup)(void);
+  // Put len cells with the same color pair at (y,x)
+  void (*writeRun)(int y, int x, const chtype* cells, int len);
+  // Show all runs written since the last call
+  void (*present)(void);
+  // NULL if the backend does not count its output
+  const struct render_stats* (*getStats)(void);
+  // The window has the new size nrows x ncols
+  void (*resize)(int nrows, int ncols);
+};
+
+extern enum ResCodes initializeDisplay(enum RenderBackends backend);
+extern void cleanupDisplay();
+extern const struct screen_layout* getLayout();
+extern bool resizeDisplay(struct board* aboard);
+
+// Queue output for the current frame
+extern void queueCell(int y, int x, chtype symbol, enum ColorPairs color_pair);
+extern void queueString(int y, int x, const char* text,
+                        enum ColorPairs color_pair);
+extern void drawChanges(const struct change_list* changes);
+
+// The viewport onto the board
+extern void setViewport(struct board* aboard, int nrows, int ncols);
+extern bool resizeViewport(int nrows, int ncols);
+extern bool followPos(int y, int x);
+extern void drawViewport(struct board* aboard);
+extern void drawViewportArea(struct board* aboard, int y, int x, int nrows,
+                             int ncols);
+
+// Pass all queued cells to the backend; call presentFrame() afterwards
+extern void flushFrame();
+extern void presentFrame();
+extern const struct render_stats* getRenderStats();
+
+#endif  // #define _DISPLAY_H
@@ -0,0 +1,363 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The spectator feed: the running game in POSIX shared memory
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "feed.h"
+#include "board_model.h"
+#include "worm.h"
+
+// Bytes of a feed for a board of nrows x ncols
+static size_t feedSize(uint32_t nrows, uint32_t ncols) {
+  return sizeof(struct feed_header) +
+         FEED_CAPACITY * sizeof(struct feed_cell) +
+         (size_t)nrows * ncols * sizeof(struct feed_look);
+}
+
+// Names of shared memory objects start with a slash
+static void feedName(char* buf, size_t size, const char* name) {
+  snprintf(buf, size, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+// ************************************
+// The writer
+// ************************************
+
+// The seqlock: readers retry while seq is odd or has changed
+static void beginUpdate(struct feed_header* aheader) {
+  __atomic_store_n(&aheader->seq, aheader->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE); // seq is odd before any update
+}
+
+static void endUpdate(struct feed_header* aheader) {
+  __atomic_store_n(&aheader->seq, aheader->seq + 1, __ATOMIC_RELEASE);
+}
+
+// Copy the whole board into the image
+static void writeImage(struct feed_writer* awriter, struct board* aboard) {
+  uint32_t ncols = awriter->header->ncols;
+  uint32_t y, x;
+
+  for (y = 0; y < awriter->header->nrows; y++) {
+    for (x = 0; x < ncols; x++) {
+      struct look look = getLookAt(aboard, y, x);
+      awriter->image[y * ncols + x].symbol = look.symbol & A_CHARTEXT;
+      awriter->image[y * ncols + x].color_pair = look.color_pair;
+    }
+  }
+}
+
+// Create the shared memory object name for the board of the game.
+// An old object of that name is replaced; spectators still showing it
+// keep their mapping until they let it go.
+enum ResCodes startFeed(struct feed_writer* awriter, const char* name,
+                        struct board* aboard) {
+  struct feed_header* aheader;
+  int fd;
+
+  awriter->header = NULL;
+  feedName(awriter->name, sizeof(awriter->name), name);
+  awriter->size = feedSize(getLastRow(aboard) + 1, getLastCol(aboard) + 1);
+
+  shm_unlink(awriter->name);
+  fd = shm_open(awriter->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    return RES_FAILED;
+  }
+  if (ftruncate(fd, awriter->size) != 0) {
+    close(fd);
+    shm_unlink(awriter->name);
+    return RES_FAILED;
+  }
+  aheader = mmap(NULL, awriter->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  close(fd); // The mapping stays
+  if (aheader == MAP_FAILED) {
+    shm_unlink(awriter->name);
+    return RES_FAILED;
+  }
+  awriter->header = aheader;
+  awriter->cells = (struct feed_cell*)(aheader + 1);
+  awriter->image = (struct feed_look*)(awriter->cells + FEED_CAPACITY);
+
+  // The new object is all zeros
+  aheader->version = FEED_VERSION;
+  aheader->nrows = getLastRow(aboard) + 1;
+  aheader->ncols = getLastCol(aboard) + 1;
+  aheader->capacity = FEED_CAPACITY;
+  aheader->pid = getpid();
+  aheader->epoch = 1;
+  writeImage(awriter, aboard);
+  // Readers look at nothing else before they see the magic
+  __atomic_store_n(&aheader->magic, FEED_MAGIC, __ATOMIC_RELEASE);
+  return RES_OK;
+}
+
+// Publish the changes of a frame (may be NULL) and the status.
+// Takes time in proportion to the number of changes; never waits.
+void publishFrame(struct feed_writer* awriter,
+                  const struct change_list* changes,
+                  const struct feed_status* astatus) {
+  struct feed_header* aheader = awriter->header;
+  int count = changes != NULL ? changes->count : 0;
+  uint32_t ncols;
+  uint64_t head;
+  int n, i;
+
+  if (aheader == NULL) {
+    return;
+  }
+  ncols = aheader->ncols;
+  head = aheader->head;
+  n = count; // Cells going into the ring
+
+  beginUpdate(aheader);
+  if (n > FEED_CAPACITY) {
+    // Too many for the ring: the readers have to take the image
+    aheader->epoch++;
+    n = 0;
+  }
+  // Readers check the claim when they have read the ring
+  __atomic_store_n(&aheader->claimed, head + n, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (i = 0; i < count; i++) {
+    const struct cell_change* change = &changes->cells[i];
+    struct feed_look* alook = &awriter->image[change->y * ncols + change->x];
+
+    alook->symbol = change->symbol & A_CHARTEXT;
+    alook->color_pair = change->color_pair;
+    if (n > 0) {
+      struct feed_cell* acell =
+          &awriter->cells[(head + i) & (FEED_CAPACITY - 1)];
+      acell->y = change->y;
+      acell->x = change->x;
+      acell->symbol = alook->symbol;
+      acell->color_pair = alook->color_pair;
+    }
+  }
+  __atomic_store_n(&aheader->head, head + n, __ATOMIC_RELAXED);
+  aheader->frame++;
+  aheader->status = *astatus;
+  endUpdate(aheader);
+}
+
+// The board has changed as a whole (e.g. a game has been loaded)
+void republishBoard(struct feed_writer* awriter, struct board* aboard) {
+  if (awriter->header == NULL) {
+    return;
+  }
+  beginUpdate(awriter->header);
+  awriter->header->epoch++;
+  writeImage(awriter, aboard);
+  endUpdate(awriter->header);
+}
+
+// Tell the readers that the game is over and remove the object
+void stopFeed(struct feed_writer* awriter) {
+  if (awriter->header == NULL) {
+    return;
+  }
+  __atomic_store_n(&awriter->header->closed, 1, __ATOMIC_RELEASE);
+  munmap(awriter->header, awriter->size);
+  shm_unlink(awriter->name);
+  awriter->header = NULL;
+}
+
+// ************************************
+// The readers
+// ************************************
+
+// Map the feed name read-only
+enum ResCodes openFeed(struct feed_reader* areader, const char* name) {
+  char shm_name[64];
+  const struct feed_header* aheader;
+  struct stat st;
+  int fd;
+
+  feedName(shm_name, sizeof(shm_name), name);
+  fd = shm_open(shm_name, O_RDONLY, 0);
+  if (fd < 0) {
+    return RES_FAILED;
+  }
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*aheader)) {
+    close(fd);
+    return RES_FAILED;
+  }
+  aheader = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (aheader == MAP_FAILED) {
+    return RES_FAILED;
+  }
+  if (__atomic_load_n(&aheader->magic, __ATOMIC_ACQUIRE) != FEED_MAGIC ||
+      aheader->version != FEED_VERSION ||
+      aheader->capacity != FEED_CAPACITY ||
+      feedSize(aheader->nrows, aheader->ncols) > (size_t)st.st_size) {
+    munmap((void*)aheader, st.st_size);
+    return RES_FAILED;
+  }
+  areader->size = st.st_size;
+  areader->header = aheader;
+  areader->cells = (const struct feed_cell*)(aheader + 1);
+  areader->image = (const struct feed_look*)(areader->cells + FEED_CAPACITY);
+  areader->applied = 0;
+  areader->epoch = 0; // The writer starts with 1: take the image first
+  areader->frame = 0;
+  memset(&areader->status, 0, sizeof(areader->status));
+  return RES_OK;
+}
+
+void closeFeed(struct feed_reader* areader) {
+  munmap((void*)areader->header, areader->size);
+  areader->header = NULL;
+}
+
+// The header fields guarded by the seqlock
+struct feed_snapshot {
+  uint64_t frame;
+  uint64_t epoch;
+  uint64_t head;
+  struct feed_status status;
+};
+
+// Copy the guarded fields consistently.
+// Returns false if the writer was busy every time we looked.
+static bool readHeader(struct feed_reader* areader,
+                       struct feed_snapshot* asnap) {
+  const struct feed_header* aheader = areader->header;
+  int tries;
+
+  for (tries = 0; tries < FEED_SEQLOCK_TRIES; tries++) {
+    uint64_t seq = __atomic_load_n(&aheader->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+      continue; // An update is going on
+    }
+    asnap->frame = __atomic_load_n(&aheader->frame, __ATOMIC_RELAXED);
+    asnap->epoch = __atomic_load_n(&aheader->epoch, __ATOMIC_RELAXED);
+    asnap->head = __atomic_load_n(&aheader->head, __ATOMIC_RELAXED);
+    memcpy(&asnap->status, (const void*)&aheader->status,
+           sizeof(asnap->status));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&aheader->seq, __ATOMIC_RELAXED) == seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Show a cell on the reader's board, unless it looks like this already
+static void applyLook(struct board* aboard, int y, int x, chtype symbol,
+                      enum ColorPairs color_pair) {
+  struct look look = getLookAt(aboard, y, x);
+
+  if (look.symbol != symbol || look.color_pair != color_pair) {
+    placeItem(aboard, y, x,
+              symbol == SYMBOL_FREE_CELL ? BC_FREE_CELL : BC_USED_BY_WORM,
+              symbol, color_pair);
+  }
+}
+
+// Apply the ring cells from..to-1.
+// Returns false if the writer has overwritten some of them meanwhile.
+static bool applyRing(struct feed_reader* areader, struct board* aboard,
+                      uint64_t from, uint64_t to) {
+  uint64_t i;
+
+  for (i = from; i < to; i++) {
+    const struct feed_cell* acell =
+        &areader->cells[i & (FEED_CAPACITY - 1)];
+    struct feed_cell cell = *acell;
+
+    if (cell.y < areader->header->nrows && cell.x < areader->header->ncols) {
+      applyLook(aboard, cell.y, cell.x, cell.symbol,
+                (enum ColorPairs)cell.color_pair);
+    }
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&areader->header->claimed, __ATOMIC_RELAXED) - from <=
+         FEED_CAPACITY;
+}
+
+// Take the whole board from the image. Cells changing while we copy are
+// corrected by the ring cells written meanwhile.
+static bool takeImage(struct feed_reader* areader, struct board* aboard,
+                      struct feed_snapshot* asnap) {
+  uint32_t ncols = areader->header->ncols;
+  int tries;
+
+  for (tries = 0; tries < FEED_SEQLOCK_TRIES; tries++) {
+    struct feed_snapshot after;
+    uint32_t y, x;
+
+    for (y = 0; y < areader->header->nrows; y++) {
+      for (x = 0; x < ncols; x++) {
+        struct feed_look look = areader->image[y * ncols + x];
+        applyLook(aboard, y, x, look.symbol,
+                  (enum ColorPairs)look.color_pair);
+      }
+    }
+    if (!readHeader(areader, &after)) {
+      return false;
+    }
+    if (after.epoch == asnap->epoch &&
+        applyRing(areader, aboard, asnap->head, after.head)) {
+      *asnap = after;
+      return true;
+    }
+    *asnap = after; // Too much has happened: once more
+  }
+  return false;
+}
+
+// Has the writer ended or died?
+static bool isFeedClosed(struct feed_reader* areader) {
+  return __atomic_load_n(&areader->header->closed, __ATOMIC_ACQUIRE) ||
+         (kill((pid_t)areader->header->pid, 0) != 0 && errno == ESRCH);
+}
+
+// Bring aboard up to date with the feed. The changes are in the change
+// list of aboard, as if the reader had stepped the game itself.
+enum FeedEvents pollFeed(struct feed_reader* areader, struct board* aboard) {
+  struct feed_snapshot snap;
+  uint64_t from = areader->applied;
+
+  if (!readHeader(areader, &snap)) {
+    return FEED_NO_FRAME;
+  }
+  if (snap.frame == areader->frame && snap.epoch == areader->epoch) {
+    return isFeedClosed(areader) ? FEED_CLOSED : FEED_NO_FRAME;
+  }
+  if (snap.epoch == areader->epoch && snap.head - from <= FEED_CAPACITY &&
+      applyRing(areader, aboard, from, snap.head)) {
+    areader->applied = snap.head;
+    areader->frame = snap.frame;
+    areader->status = snap.status;
+    return FEED_FRAME;
+  }
+  // We have missed cells or the image is new
+  if (!takeImage(areader, aboard, &snap)) {
+    return FEED_NO_FRAME;
+  }
+  areader->applied = snap.head;
+  areader->epoch = snap.epoch;
+  areader->frame = snap.frame;
+  areader->status = snap.status;
+  return FEED_RESYNCED;
+}
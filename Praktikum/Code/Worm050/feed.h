@@ -0,0 +1,131 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The spectator feed: the running game in POSIX shared memory
+//
+// The game (the writer) publishes each frame into a shared memory object;
+// any number of spectators (readers, see spectator.c) map it read-only.
+// The writer never waits for a reader and does not even know about them.
+//
+// The object holds a header, a ring of changed cells and an image of the
+// whole board:
+// - The header fields below seq are guarded by a seqlock. The writer makes
+//   seq odd, updates the fields and makes seq even again. A reader copies
+//   the fields and retries if seq was odd or has changed meanwhile.
+// - The ring holds the last FEED_CAPACITY changed cells; head counts all
+//   cells ever written. A reader keeps its own count of the cells it has
+//   applied. If the writer has claimed more than FEED_CAPACITY cells
+//   beyond it, the reader has missed cells and takes the image again.
+// - The image is updated together with the ring. A reader that takes it
+//   notes head first and applies the ring from there afterwards; thus cells
+//   that change while the image is copied are corrected.
+// The writer sets epoch to a new value if the image has changed without
+// the changes being in the ring (e.g. after loading a game).
+
+#ifndef _FEED_H
+#define _FEED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "worm.h"
+#include "board_model.h"
+
+#define FEED_NAME "/worm-feed"   // Default name of the shared memory object
+#define FEED_MAGIC 0x4657524dU   // "MRWF": the header is complete
+#define FEED_VERSION 1
+#define FEED_CAPACITY (1 << 18)  // Cells in the ring; a power of two
+#define FEED_SEQLOCK_TRIES 1000  // A reader gives up a frame after so many
+
+// A changed cell in the ring
+struct feed_cell {
+  uint32_t y;
+  uint32_t x;
+  uint16_t symbol;
+  uint16_t color_pair;
+};
+
+// A cell of the image
+struct feed_look {
+  uint8_t symbol;
+  uint8_t color_pair;
+};
+
+// What a spectator shows besides the board
+struct feed_status {
+  int64_t tick;       // Number of steps done so far
+  int32_t game_state; // enum GameStates of the user worm
+  int32_t head_y;     // Head of the user worm
+  int32_t head_x;
+  int64_t length;     // Length of the user worm
+};
+
+// The start of the shared memory object
+struct feed_header {
+  uint32_t magic;     // FEED_MAGIC once the writer has set up everything
+  uint32_t version;
+  uint32_t nrows;     // Size of the board and the image
+  uint32_t ncols;
+  uint32_t capacity;  // Cells in the ring
+  uint32_t closed;    // The writer has finished
+  int64_t pid;        // Process of the writer
+  uint64_t claimed;   // Cells the writer has begun to write into the ring
+
+  uint64_t seq;       // The seqlock: odd while the writer updates
+  uint64_t frame;     // Number of frames published
+  uint64_t epoch;     // Changes when the ring cannot bring a reader up to date
+  uint64_t head;      // Number of cells written into the ring
+  struct feed_status status;
+};
+
+// The game's side
+struct feed_writer {
+  char name[64];               // Name of the shared memory object
+  size_t size;                 // Size of the mapping
+  struct feed_header* header;  // NULL: no feed
+  struct feed_cell* cells;     // The ring
+  struct feed_look* image;     // The board, row by row
+};
+
+// A spectator's side
+struct feed_reader {
+  size_t size;
+  const struct feed_header* header;
+  const struct feed_cell* cells;
+  const struct feed_look* image;
+  uint64_t applied;            // Number of ring cells applied so far
+  uint64_t epoch;              // Epoch of the image taken last
+  uint64_t frame;              // Last frame seen
+  struct feed_status status;   // Status of that frame
+};
+
+// Why pollFeed returned
+enum FeedEvents {
+  FEED_NO_FRAME,  // Nothing new (or the writer is busy right now)
+  FEED_FRAME,     // The board has the changes of at least one new frame
+  FEED_RESYNCED,  // The board has been taken from the image again
+  FEED_CLOSED,    // The game is over or the writer is gone
+};
+
+extern enum ResCodes startFeed(struct feed_writer* awriter, const char* name,
+                               struct board* aboard);
+extern void publishFrame(struct feed_writer* awriter,
+                         const struct change_list* changes,
+                         const struct feed_status* astatus);
+extern void republishBoard(struct feed_writer* awriter,
+                           struct board* aboard);
+extern void stopFeed(struct feed_writer* awriter);
+
+extern enum ResCodes openFeed(struct feed_reader* areader, const char* name);
+extern void closeFeed(struct feed_reader* areader);
+extern enum FeedEvents pollFeed(struct feed_reader* areader,
+                                struct board* aboard);
+
+#endif  // #define _FEED_H
@@ -0,0 +1,388 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The simulation core: one game without any curses calls
+//
+// The core only updates the models. All changed cells are collected
+// in the board's change list, which is rendered by the caller
+// (see display.c) or simply ignored if we run headless.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "game.h"
+#include "board_model.h"
+#include "rng.h"
+#include "state_buffer.h"
+#include "worker_pool.h"
+#include "worm.h"
+#include "worm_model.h"
+
+// Number of attempts to find a free start position for a bot worm
+#define BOT_PLACEMENT_TRIES 100
+
+// Is the cell at pos inside the board and free?
+static bool isFreeCell(struct board* aboard, struct pos pos) {
+  return isInsideBoard(aboard, pos.y, pos.x) &&
+         getContentAt(aboard, pos.y, pos.x) == BC_FREE_CELL;
+}
+
+// Put a bot worm onto a random free cell
+static void addBotWorm(struct game* agame) {
+  struct board* aboard = &agame->board;
+  struct pos headpos;
+  int tries;
+  int id;
+
+  for (tries = 0; tries < BOT_PLACEMENT_TRIES; tries++) {
+    headpos.y = randomBelow(&agame->rng, getLastRow(aboard) + 1);
+    headpos.x = randomBelow(&agame->rng, getLastCol(aboard) + 1);
+    if (isFreeCell(aboard, headpos)) {
+      id = addWorm(&agame->worms, agame->settings.worm_length, headpos,
+                   (enum WormHeading)randomBelow(&agame->rng, 4),
+                   COLP_BOT_WORM);
+      if (id >= 0) {
+        showWorm(aboard, &agame->worms, id);
+      }
+      return;
+    }
+  }
+  // The board is too crowded: we simply go without this worm
+}
+
+// Settings of a game on a small board with the user worm only
+void defaultGameSettings(struct game_settings* asettings) {
+  asettings->nrows = MIN_NUMBER_OF_ROWS;
+  asettings->ncols = MIN_NUMBER_OF_COLS;
+  asettings->nworms = 1;
+  asettings->worm_length = WORM_LENGTH;
+  asettings->seed = 0;
+}
+
+// Is nrows x ncols a board we can play on, with at most max_cells cells?
+bool isValidBoardSize(int nrows, int ncols, long max_cells) {
+  return nrows >= MIN_NUMBER_OF_ROWS && ncols >= MIN_NUMBER_OF_COLS &&
+         (long)nrows * ncols <= max_cells;
+}
+
+// Parse a board size ROWSxCOLS as given by option --board.
+// Returns false if arg is no such size or not a valid one.
+bool parseBoardSize(const char* arg, long max_cells, int* nrows,
+                    int* ncols) {
+  int y, x;
+  char end;
+
+  if (sscanf(arg, "%dx%d%c", &y, &x, &end) != 2 ||
+      !isValidBoardSize(y, x, max_cells)) {
+    return false;
+  }
+  *nrows = y;
+  *ncols = x;
+  return true;
+}
+
+// Set up a new game on a board with nrows rows and ncols columns.
+// Besides the user worm there are nworms - 1 bot worms.
+enum ResCodes initializeGame(struct game* agame,
+                             const struct game_settings* asettings) {
+  int nworms = asettings->nworms;
+  uint64_t seed = asettings->seed;
+  enum ResCodes res_code;
+  struct pos bottomLeft; // Start position of the worm
+  int i;
+
+  if (nworms < 1 || nworms > MAX_WORMS || asettings->worm_length < 1) {
+    return RES_FAILED;
+  }
+  agame->settings = *asettings;
+
+  // At the beginnung of the game, we still have a chance to win
+  agame->game_state = WORM_GAME_ONGOING;
+  agame->tick = 0;
+  agame->pool = NULL;
+  seedRng(&agame->rng, seed);
+
+  // Each worm steers with its own random numbers; thus steering does not
+  // depend on the order in which the worms are processed
+  agame->bot_rng = malloc(nworms * sizeof(struct rng));
+  if (agame->bot_rng == NULL) {
+    return RES_FAILED;
+  }
+  for (i = 0; i < nworms; i++) {
+    seedRng(&agame->bot_rng[i], seed ^ ((uint64_t)(i + 1) << 32));
+  }
+
+  res_code = initializeBoard(&agame->board, asettings->nrows,
+                             asettings->ncols);
+  if (res_code != RES_OK) {
+    free(agame->bot_rng);
+    return res_code;
+  }
+  res_code = initializeWormTable(&agame->worms, nworms);
+  if (res_code != RES_OK) {
+    cleanupBoard(&agame->board);
+    free(agame->bot_rng);
+    return res_code;
+  }
+
+  // There is always an initialized user worm.
+  // Initialize the userworm with its size, position, heading.
+  bottomLeft.y = getLastRow(&agame->board);
+  bottomLeft.x = 0;
+  if (addWorm(&agame->worms, asettings->worm_length, bottomLeft, WORM_RIGHT,
+              COLP_USER_WORM_HEAD) != USER_WORM_ID) {
+    cleanupGame(agame);
+    return RES_FAILED;
+  }
+  // Show worm at its initial position
+  showWorm(&agame->board, &agame->worms, USER_WORM_ID);
+
+  for (i = 1; i < nworms; i++) {
+    addBotWorm(agame);
+  }
+  return RES_OK;
+}
+
+// Free all resources of the game
+void cleanupGame(struct game* agame) {
+  free(agame->bot_rng);
+  agame->bot_rng = NULL;
+  cleanupWormTable(&agame->worms);
+  cleanupBoard(&agame->board);
+}
+
+// Choose the heading of a bot worm: now and then turn by chance,
+// and avoid running into an obstacle if there is a way out
+void steerBot(struct game* agame, int id) {
+  struct worm_table* atable = &agame->worms;
+  struct pos headpos = getWormHeadPos(atable, id);
+  enum WormHeading dir = getWormHeading(atable, id);
+
+  struct rng* arng = &agame->bot_rng[id];
+  int first, i;
+
+  if (randomBelow(arng, BOT_TURN_CHANCE) == 0) {
+    dir = (enum WormHeading)randomBelow(arng, 4);
+    if (isWormReversal(atable, id, dir)) {
+      dir = getWormHeading(atable, id);
+    }
+  }
+  if (!isFreeCell(&agame->board, getNeighbourPos(headpos, dir))) {
+    // Try all directions, beginning with a random one
+    first = randomBelow(arng, 4);
+    for (i = 0; i < 4; i++) {
+      enum WormHeading trydir = (enum WormHeading)((first + i) % 4);
+      if (isFreeCell(&agame->board, getNeighbourPos(headpos, trydir))) {
+        dir = trydir;
+        break;
+      }
+    }
+  }
+  setWormHeading(atable, id, dir);
+}
+
+// Let the user worm run counterclockwise along the border of the board
+void steerAlongBorder(struct game* agame) {
+  struct worm_table* atable = &agame->worms;
+  struct pos headpos = getWormHeadPos(atable, USER_WORM_ID);
+
+  switch (getWormHeading(atable, USER_WORM_ID)) {
+  case WORM_RIGHT:
+    if (headpos.x == getLastCol(&agame->board)) {
+      setWormHeading(atable, USER_WORM_ID, WORM_UP);
+    }
+    break;
+  case WORM_UP:
+    if (headpos.y == 0) {
+      setWormHeading(atable, USER_WORM_ID, WORM_LEFT);
+    }
+    break;
+  case WORM_LEFT:
+    if (headpos.x == 0) {
+      setWormHeading(atable, USER_WORM_ID, WORM_DOWN);
+    }
+    break;
+  case WORM_DOWN:
+    if (headpos.y == getLastRow(&agame->board)) {
+      setWormHeading(atable, USER_WORM_ID, WORM_RIGHT);
+    }
+    break;
+  }
+}
+
+// Let the worms begin..end-1 choose their headings and propose their moves.
+// Touches only the slots of these worms and reads the board.
+static void steerAndPropose(void* arg, int begin, int end) {
+  struct game* agame = arg;
+  int id;
+
+  for (id = begin; id < end; id++) {
+    if (id != USER_WORM_ID &&
+        getWormState(&agame->worms, id) == WORM_GAME_ONGOING) {
+      steerBot(agame, id);
+    }
+  }
+  proposeMoves(&agame->board, &agame->worms, begin, end);
+}
+
+// Use the threads of apool for the following ticks (NULL: no threads).
+// The result of a tick does not depend on the number of threads.
+void setGameWorkers(struct game* agame, struct worker_pool* apool) {
+  agame->pool = apool;
+}
+
+// First half of a tick: forget the changes of the previous tick and
+// clean the tails of the worms
+void stepGameTails(struct game* agame) {
+  // Changes of the previous tick have been rendered (or are of no interest)
+  clearChanges(&agame->board);
+
+  if (agame->game_state != WORM_GAME_ONGOING) {
+    return;
+  }
+  // Clean the tails of the worms
+  cleanWormTails(&agame->board, &agame->worms);
+}
+
+// Second half of a tick: steer, move and show the worms.
+// Returns the list of cells changed by the tick.
+const struct change_list* stepGameMoves(struct game* agame) {
+  struct worm_table* atable = &agame->worms;
+
+  if (agame->game_state != WORM_GAME_ONGOING) {
+    return &agame->board.changes;
+  }
+  // Let the bots choose their headings and compute all new head positions.
+  // This is the expensive part; it may run on several threads.
+  if (agame->pool != NULL) {
+    runOnWorkers(agame->pool, steerAndPropose, agame, atable->nworms);
+  } else {
+    steerAndPropose(agame, 0, atable->nworms);
+  }
+  // Settle conflicts in a fixed order and move the worms
+  resolveMoves(&agame->board, atable);
+  // Show the worms at their new positions
+  showWorms(&agame->board, atable);
+
+  // The game goes on as long as the user worm lives
+  agame->game_state = getWormState(atable, USER_WORM_ID);
+  agame->tick++;
+  return &agame->board.changes;
+}
+
+// Advance the game by one tick.
+// Returns the list of cells changed by this tick.
+// The game loop calls the two halves itself in order to time them.
+const struct change_list* stepGame(struct game* agame) {
+  stepGameTails(agame);
+  return stepGameMoves(agame);
+}
+
+// A fingerprint of the state of the game (FNV-1a).
+// Used to check that different runs lead to the same state.
+uint64_t hashGame(struct game* agame) {
+  struct board* aboard = &agame->board;
+  struct worm_table* atable = &agame->worms;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  long ncells = (long)(getLastRow(aboard) + 1) * (getLastCol(aboard) + 1);
+  long i;
+  int id;
+
+  for (i = 0; i < ncells; i++) {
+    hash = (hash ^ aboard->cells[i]) * 0x100000001b3ULL;
+  }
+  for (id = 0; id < atable->nworms; id++) {
+    hash = (hash ^ (uint64_t)atable->headpos[id].y) * 0x100000001b3ULL;
+    hash = (hash ^ (uint64_t)atable->headpos[id].x) * 0x100000001b3ULL;
+    hash = (hash ^ (uint64_t)atable->state[id]) * 0x100000001b3ULL;
+  }
+  hash = (hash ^ (uint64_t)agame->tick) * 0x100000001b3ULL;
+  return hash;
+}
+
+// An upper bound of the number of bytes written by saveGame.
+// Used to allocate buffers before the game is saved.
+size_t savedGameSize(struct game* agame) {
+  struct worm_table* atable = &agame->worms;
+  size_t ncells = (size_t)(getLastRow(&agame->board) + 1) *
+                  (getLastCol(&agame->board) + 1);
+  size_t size;
+  int id;
+
+  // Game: counters and random numbers
+  size = 4 + 8 + 1 + 8 + 8 * (size_t)agame->settings.nworms;
+  // Board: size, looks and cells
+  size += 8 + 1 + 9 * MAX_LOOKS + 2 * ncells;
+  // Worms: fixed part and bodies
+  size += 4;
+  for (id = 0; id < atable->nworms; id++) {
+    size += 37 + 8 * (size_t)getWormLength(atable, id);
+  }
+  return size;
+}
+
+// Append the full state of the game to abuf: the board, all worms and
+// the state of all random number generators
+void saveGame(struct game* agame, struct state_buffer* abuf) {
+  int i;
+
+  putUint32(abuf, agame->settings.nworms);
+  putUint64(abuf, (uint64_t)agame->tick);
+  putUint8(abuf, agame->game_state);
+  putUint64(abuf, agame->rng.state);
+  for (i = 0; i < agame->settings.nworms; i++) {
+    putUint64(abuf, agame->bot_rng[i].state);
+  }
+  saveBoard(&agame->board, abuf);
+  saveWormTable(&agame->worms, abuf);
+}
+
+// Continue agame from the state saved in abuf.
+// agame must have been set up with the settings of the saved game.
+// Saved data that does not fit the game is rejected; on failure agame is
+// in an undefined state and must be cleaned up.
+enum ResCodes loadGame(struct game* agame, struct state_buffer* abuf) {
+  uint8_t game_state;
+  int i;
+
+  if (getUint32(abuf) != (uint32_t)agame->settings.nworms) {
+    return RES_FAILED;
+  }
+  agame->tick = (long)getUint64(abuf);
+  game_state = getUint8(abuf);
+  agame->game_state = (enum GameStates)game_state;
+  agame->rng.state = getUint64(abuf);
+  for (i = 0; i < agame->settings.nworms; i++) {
+    agame->bot_rng[i].state = getUint64(abuf);
+  }
+  if (abuf->failed || game_state > WORM_OUT_OF_MEMORY || agame->tick < 0 ||
+      loadBoard(&agame->board, abuf) != RES_OK ||
+      loadWormTable(&agame->board, &agame->worms, abuf) != RES_OK) {
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Name of a game state for reports
+const char* gameStateName(enum GameStates state) {
+  switch (state) {
+  case WORM_GAME_ONGOING:
+    return "WORM_GAME_ONGOING";
+  case WORM_OUT_OF_BOUNDS:
+    return "WORM_OUT_OF_BOUNDS";
+  case WORM_CROSSING:
+    return "WORM_CROSSING";
+  case WORM_GAME_QUIT:
+    return "WORM_GAME_QUIT";
+  case WORM_OUT_OF_MEMORY:
+    return "WORM_OUT_OF_MEMORY";
+  }
+  return "?";
+}
@@ -0,0 +1,71 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The simulation core: one game without any curses calls
+
+#ifndef _GAME_H
+#define _GAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "worm.h"
+#include "board_model.h"
+#include "worm_model.h"
+#include "rng.h"
+#include "state_buffer.h"
+#include "worker_pool.h"
+
+#define USER_WORM_ID 0 // The user's worm is always the first in the table
+#define MAX_WORMS 16384 // Maximal number of worms in a game
+#define BOT_TURN_CHANCE 8 // A bot worm turns by chance once in so many ticks
+#define MAX_BOARD_CELLS (1L << 26) // Maximal rows * cols, e.g. 8192x8192
+
+// Everything needed to set up a game.
+// The same settings always lead to the same game.
+struct game_settings {
+  int nrows;        // Size of the board
+  int ncols;
+  int nworms;       // Number of worms including the user worm
+  long worm_length; // Length of the worms when fully grown
+  uint64_t seed;    // Seed for all random numbers of the game
+};
+
+// The complete state of a running game
+struct game {
+  struct game_settings settings; // How the game has been set up
+  struct board board;         // The board and its pending changes
+  struct worm_table worms;    // All worms; the user worm has USER_WORM_ID
+  struct rng rng;             // Random numbers for placing worms
+  struct rng* bot_rng;        // Random numbers for steering; one per worm
+  struct worker_pool* pool;   // Threads for stepping; NULL: no threads
+  enum GameStates game_state; // The current game state (of the user worm)
+  long tick;                  // Number of steps done so far
+};
+
+extern void defaultGameSettings(struct game_settings* asettings);
+extern bool isValidBoardSize(int nrows, int ncols, long max_cells);
+extern bool parseBoardSize(const char* arg, long max_cells, int* nrows,
+                           int* ncols);
+extern enum ResCodes initializeGame(struct game* agame,
+                                    const struct game_settings* asettings);
+extern void cleanupGame(struct game* agame);
+extern const struct change_list* stepGame(struct game* agame);
+extern void stepGameTails(struct game* agame);
+extern const struct change_list* stepGameMoves(struct game* agame);
+extern void steerBot(struct game* agame, int id);
+extern void steerAlongBorder(struct game* agame);
+extern void setGameWorkers(struct game* agame, struct worker_pool* apool);
+extern uint64_t hashGame(struct game* agame);
+extern const char* gameStateName(enum GameStates state);
+extern size_t savedGameSize(struct game* agame);
+extern void saveGame(struct game* agame, struct state_buffer* abuf);
+extern enum ResCodes loadGame(struct game* agame, struct state_buffer* abuf);
+
+#endif  // #define _GAME_H
@@ -0,0 +1,51 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Buffered heading changes of the user
+
+#include <stdbool.h>
+
+#include "input_queue.h"
+#include "worm.h"
+#include "worm_model.h"
+
+void initializeInputQueue(struct input_queue* aqueue) {
+  aqueue->first = 0;
+  aqueue->count = 0;
+}
+
+// Buffer a direction key.
+// Returns false if the queue is full; the key is dropped then.
+bool enqueueHeading(struct input_queue* aqueue, enum WormHeading dir) {
+  if (aqueue->count == INPUT_QUEUE_CAPACITY) {
+    return false;
+  }
+  aqueue->headings[(aqueue->first + aqueue->count) % INPUT_QUEUE_CAPACITY] =
+      dir;
+  aqueue->count++;
+  return true;
+}
+
+// Apply the oldest buffered key that really changes the heading of the worm.
+// Keys for the current heading and reversals onto the worm's own neck
+// are dropped on the way. Called once per tick before the worm moves.
+void applyNextHeading(struct input_queue* aqueue, struct worm_table* atable,
+                      int id) {
+  while (aqueue->count > 0) {
+    enum WormHeading dir = aqueue->headings[aqueue->first];
+    aqueue->first = (aqueue->first + 1) % INPUT_QUEUE_CAPACITY;
+    aqueue->count--;
+
+    if (dir != getWormHeading(atable, id) &&
+        !isWormReversal(atable, id, dir)) {
+      setWormHeading(atable, id, dir);
+      return; // At most one change per tick
+    }
+  }
+}
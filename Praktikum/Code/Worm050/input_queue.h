@@ -0,0 +1,36 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Buffered heading changes of the user
+//
+// All direction keys pressed between two ticks are kept in a small ring.
+// Each tick applies at most one real change of the heading; the remaining
+// keys are carried over to the following ticks.
+
+#ifndef _INPUT_QUEUE_H
+#define _INPUT_QUEUE_H
+
+#include <stdbool.h>
+#include "worm.h"
+#include "worm_model.h"
+
+#define INPUT_QUEUE_CAPACITY 8 // Maximal number of buffered direction keys
+
+struct input_queue {
+  enum WormHeading headings[INPUT_QUEUE_CAPACITY];
+  int first; // Index of the oldest element
+  int count; // Number of buffered elements
+};
+
+extern void initializeInputQueue(struct input_queue* aqueue);
+extern bool enqueueHeading(struct input_queue* aqueue, enum WormHeading dir);
+extern void applyNextHeading(struct input_queue* aqueue,
+                             struct worm_table* atable, int id);
+
+#endif  // #define _INPUT_QUEUE_H
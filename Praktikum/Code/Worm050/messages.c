@@ -8,83 +8,289 @@
 // (C) 2011
 //
 // Displaying messages and dialogs
+//
+// All output is queued in the display (see display.c) and written
+// in runs by flushFrame().
 
 #include <curses.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "worm.h"
 #include "board_model.h"
 #include "worm_model.h"
+#include "display.h"
 #include "messages.h"
 
 // Clear an entire line on the display
 void clearLineInMessageArea(int row) {
     int i;
 
-    move(row,0);
-    for (i = 1; i <= COLS; i++) {
-        addch(' ');
+    for (i = 0; i < getLayout()->ncols; i++) {
+        queueCell(row, i, ' ', COLP_MESSAGE);
     }
 }
 
 // Display the board line in order to separate the message area
 void showBorderLine() {
-    int pos_line0 = LINES -ROWS_RESERVED ;
+    int pos_line0 = getLayout()->message_row;
     int i;
 
-    for (i = 0; i < COLS ; i++) {
-        move(pos_line0, i);
-        attron(COLOR_PAIR(COLP_BARRIER));
-        addch(SYMBOL_BARRIER);
-        attroff(COLOR_PAIR(COLP_BARRIER));
+    for (i = 0; i < getLayout()->ncols; i++) {
+        queueCell(pos_line0, i, SYMBOL_BARRIER, COLP_BARRIER);
+    }
+}
+
+// The window has changed its size: draw the border line at its new place
+// and clear the lines below; their contents have to be shown again
+void relayoutMessageArea() {
+    int pos_line0 = getLayout()->message_row;
+    int i;
+
+    showBorderLine();
+    for (i = 1; i < ROWS_RESERVED; i++) {
+        clearLineInMessageArea(pos_line0 + i);
     }
 }
 
 // Display status about the game in the message area
-void showStatus(struct worm* aworm) {
-    int pos_line2 = LINES -ROWS_RESERVED + 2;
+void showStatus(struct worm_table* atable, int id) {
+    int pos_line2 = getLayout()->message_row + 2;
+    char text[64];
 
-    struct pos headpos = getWormHeadPos(aworm);
-    mvprintw(pos_line2, 1,"Wurm ist an Position: y=%3d x=%3d", headpos.y, headpos.x);
+    struct pos headpos = getWormHeadPos(atable, id);
+    snprintf(text, sizeof(text), "Wurm ist an Position: y=%3d x=%3d",
+             headpos.y, headpos.x);
+    queueString(pos_line2, 1, text, COLP_MESSAGE);
 }
 
-// Display a dialog in the message area and wait for confirmation
-// String prompt1 is displayed in the second line of the message area
-// String prompt2 is displayed in the  third line of the message area
-int showDialog(char* prompt1, char* prompt2) {
-    int pos_line1 = LINES -ROWS_RESERVED + 1;
-    int pos_line2 = LINES -ROWS_RESERVED + 2;
-    int pos_line3 = LINES -ROWS_RESERVED + 3;
+// Display statistics about the timing of the game loop in the message area
+void showTickStatus(struct scheduler* asched) {
+    int pos_line3 = getLayout()->message_row + 3;
+    char text[64];
 
-    int ch;
+    snprintf(text, sizeof(text), "Verspaetete Ticks: %6ld uebersprungen: %6ld",
+             asched->late_ticks, asched->skipped_ticks);
+    queueString(pos_line3, 1, text, COLP_MESSAGE);
+}
 
-    if (prompt1 == NULL) {
-        return RES_FAILED;
-    } 
+// Letters of the phases in the profile; see usage.txt
+static const char phase_letters[NUMBER_OF_PHASES] = {
+    'E', 'S', 'B', 'Z', 'A', 'W'};
+
+// Format a duration with at most 5 characters, e.g. "850n", "12u", "3.4m"
+static void formatDuration(char* text, size_t size, long ns) {
+    if (ns < 1000) {
+        snprintf(text, size, "%ldn", ns);
+    } else if (ns < 10000) {
+        snprintf(text, size, "%.1fu", ns / 1e3);
+    } else if (ns < 1000000) {
+        snprintf(text, size, "%ldu", ns / 1000);
+    } else if (ns < 10000000) {
+        snprintf(text, size, "%.1fm", ns / 1e6);
+    } else if (ns < 1000000000) {
+        snprintf(text, size, "%ldm", ns / 1000000);
+    } else {
+        snprintf(text, size, "%.1fs", ns / 1e9);
+    }
+}
+
+// Display the profile of the game loop: a bar showing how much of the
+// frame budget the phases use (p50), and p50/p99 of every phase.
+// aprof == NULL: the profile is off; its lines are removed.
+void showProfile(struct profiler* aprof) {
+    int pos_line1 = getLayout()->message_row + 1;
+    int pos_line3 = getLayout()->message_row + 3;
+    char bar[PROFILE_BAR_WIDTH + 1];
+    char text[96];
+    char p50[8], p99[8];
+    int phase, used, len, i;
 
-    // Delete lines in the message area
     clearLineInMessageArea(pos_line1);
-    clearLineInMessageArea(pos_line2);
     clearLineInMessageArea(pos_line3);
+    if (aprof == NULL) {
+        return;
+    }
+
+    // Each phase gets its share of the bar; the rest is idle
+    used = 0;
+    for (phase = 0; phase < PHASE_SLEEP; phase++) {
+        long ns = profilePercentile(&aprof->phases[phase], 50);
+        len = (int)((ns * PROFILE_BAR_WIDTH + aprof->period_ns / 2) /
+                    aprof->period_ns);
+        for (i = 0; i < len && used < PROFILE_BAR_WIDTH; i++) {
+            bar[used++] = phase_letters[phase];
+        }
+    }
+    while (used < PROFILE_BAR_WIDTH) {
+        bar[used++] = '.';
+    }
+    bar[used] = '\0';
+    if (profilePercentile(&aprof->busy, 99) > aprof->period_ns) {
+        bar[PROFILE_BAR_WIDTH - 1] = '!'; // Some ticks miss the budget
+    }
+    snprintf(text, sizeof(text), "Budget [%s] p50 %5.1f%% p99 %5.1f%%", bar,
+             100.0 * profilePercentile(&aprof->busy, 50) / aprof->period_ns,
+             100.0 * profilePercentile(&aprof->busy, 99) / aprof->period_ns);
+    queueString(pos_line1, 1, text, COLP_MESSAGE);
 
-    // Display message
-    mvprintw(pos_line2 , 1,"%s", prompt1);
-    if (prompt2 != NULL) {
-        mvprintw(pos_line3 , 1,"%s", prompt2);
+    len = 0;
+    for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+        formatDuration(p50, sizeof(p50),
+                       profilePercentile(&aprof->phases[phase], 50));
+        formatDuration(p99, sizeof(p99),
+                       profilePercentile(&aprof->phases[phase], 99));
+        len += snprintf(text + len, sizeof(text) - len, "%c%5s/%-5s ",
+                        phase_letters[phase], p50, p99);
     }
-    refresh();
+    queueString(pos_line3, 1, text, COLP_MESSAGE);
+}
 
-    nodelay(stdscr, FALSE);
-    ch = getch();   // Wait for user to press an arbitrary key
-    nodelay(stdscr, TRUE);
+// Display the output per frame next to the tick status.
+// Only backends writing the terminal themselves count their output.
+void showRenderStatus() {
+    int pos_line3 = getLayout()->message_row + 3;
+    const struct render_stats* astats = getRenderStats();
+    char text[40];
+
+    if (astats == NULL || astats->frames == 0) {
+        return;
+    }
+    snprintf(text, sizeof(text), "%6ld B/Frame %3.1f write",
+             astats->last_bytes, (double)astats->writes / astats->frames);
+    queueString(pos_line3, 50, text, COLP_MESSAGE);
+}
+
+// Display the decision time of the autopilot next to the status.
+// apilot == NULL: the autopilot is off; the text is removed.
+void showAutopilotStatus(struct autopilot* apilot, long period_ns) {
+    int pos_line2 = getLayout()->message_row + 2;
+    char text[40];
+
+    if (apilot == NULL || apilot->decisions == 0) {
+        snprintf(text, sizeof(text), "%38s", "");
+    } else {
+        snprintf(text, sizeof(text), "Autopilot %6.1fus max %6.1fus %5.2f%%",
+                 apilot->last_ns / 1e3, apilot->max_ns / 1e3,
+                 100.0 * apilot->last_ns / period_ns);
+    }
+    queueString(pos_line2, 40, text, COLP_MESSAGE);
+}
+
+// Display a short notice in the first line of the message area.
+// It stays until the next notice replaces it.
+void showNotice(char* text) {
+    int pos_line1 = getLayout()->message_row + 1;
 
-    // Delete lines in the message area
     clearLineInMessageArea(pos_line1);
-    clearLineInMessageArea(pos_line2);
-    clearLineInMessageArea(pos_line3);
+    queueString(pos_line1, 1, text, COLP_MESSAGE);
+}
+
+// ************************************
+// Dialogs
+// ************************************
+
+// The open dialog: a box in the middle of the board area.
+// There is only one screen, thus a single dialog at a time.
+static struct {
+    bool open;
+    enum DialogModes mode;
+    char lines[2][DIALOG_MAX_TEXT];
+    int y, x;          // Upper left corner of the box on the window
+    int nrows, ncols;  // Size of the box
+    long ticks_left;   // DIALOG_TOAST: ticks until the dialog closes
+} dialog;
+
+// Put the box of the dialog into the middle of the board area
+static void placeDialog() {
+    const struct screen_layout* alayout = getLayout();
+    int width = strlen(dialog.lines[0]);
 
-    // Display changes
-    refresh();
+    if ((int)strlen(dialog.lines[1]) > width) {
+        width = strlen(dialog.lines[1]);
+    }
+    // A frame and one blank column on both sides
+    dialog.ncols = width + 4 < alayout->ncols ? width + 4 : alayout->ncols;
+    dialog.nrows = dialog.lines[1][0] != '\0' ? 4 : 3;
+    if (dialog.nrows > alayout->board_rows) {
+        dialog.nrows = alayout->board_rows;
+    }
+    dialog.y = (alayout->board_rows - dialog.nrows) / 2;
+    dialog.x = (alayout->ncols - dialog.ncols) / 2;
+}
 
-    // Return code of key pressed
-    return ch; 
+// Open a dialog showing prompt1 and prompt2 (may be NULL).
+// An open dialog is replaced. The dialog is drawn by drawDialog.
+void openDialog(struct board* aboard, enum DialogModes mode, char* prompt1,
+                char* prompt2) {
+    closeDialog(aboard);
+    snprintf(dialog.lines[0], DIALOG_MAX_TEXT, "%s", prompt1);
+    snprintf(dialog.lines[1], DIALOG_MAX_TEXT, "%s",
+             prompt2 != NULL ? prompt2 : "");
+    dialog.mode = mode;
+    dialog.ticks_left = DIALOG_TOAST_TICKS;
+    dialog.open = true;
+    placeDialog();
+    drawDialog();
+}
+
+// Close the dialog; only the cells it has covered are drawn again
+void closeDialog(struct board* aboard) {
+    if (!dialog.open) {
+        return;
+    }
+    dialog.open = false;
+    drawViewportArea(aboard, dialog.y, dialog.x, dialog.nrows, dialog.ncols);
+}
+
+bool isDialogOpen() {
+    return dialog.open;
+}
+
+// Does the open dialog stop the game and take all keys?
+bool isDialogModal() {
+    return dialog.open && dialog.mode == DIALOG_MODAL;
+}
+
+// Queue the dialog for the frame. Called after the board has been
+// queued, so the dialog stays on top of worms moving below it.
+void drawDialog() {
+    int i, j;
+
+    if (!dialog.open) {
+        return;
+    }
+    for (i = 0; i < dialog.nrows; i++) {
+        const char* text = i == 1 ? dialog.lines[0]
+                         : i == 2 ? dialog.lines[1] : "";
+        for (j = 0; j < dialog.ncols; j++) {
+            chtype ch = ' ';
+            if (i == 0 || i == dialog.nrows - 1) {
+                ch = j == 0 || j == dialog.ncols - 1 ? '+' : '-';
+            } else if (j == 0 || j == dialog.ncols - 1) {
+                ch = '|';
+            } else if (j >= 2 && *text != '\0') {
+                ch = (unsigned char)*text++;
+            }
+            queueCell(dialog.y + i, dialog.x + j, ch, COLP_MESSAGE);
+        }
+    }
+}
+
+// The window has changed its size: move the dialog into the middle again
+void relayoutDialog(struct board* aboard) {
+    if (!dialog.open) {
+        return;
+    }
+    drawViewportArea(aboard, dialog.y, dialog.x, dialog.nrows, dialog.ncols);
+    placeDialog();
+}
+
+// A tick has passed: a toast closes after DIALOG_TOAST_TICKS
+void tickDialog(struct board* aboard) {
+    if (dialog.open && dialog.mode == DIALOG_TOAST &&
+        --dialog.ticks_left <= 0) {
+        closeDialog(aboard);
+    }
 }
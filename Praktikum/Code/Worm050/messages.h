@@ -12,13 +12,42 @@
 #ifndef _MESSAGES_H
 #define _MESSAGES_H
 
+#include <stdbool.h>
 #include "worm.h"
 #include "worm_model.h"
 #include "board_model.h"
+#include "scheduler.h"
+#include "autopilot.h"
+#include "profiler.h"
+
+#define PROFILE_BAR_WIDTH 30 // Width of the frame budget bar
+
+#define DIALOG_MAX_TEXT 128    // Maximal length of a line of a dialog
+#define DIALOG_TOAST_TICKS 30  // Ticks a toast stays open
+
+// Dialogs are boxes over the board; the game loop goes on while they
+// are open. Keys reach them through readUserInput.
+enum DialogModes {
+  DIALOG_MODAL, // The game stops; the next key closes the dialog
+  DIALOG_TOAST, // The game goes on; the dialog closes by itself
+};
 
 extern void clearLineInMessageArea(int row);
 extern void showBorderLine();
-extern void showStatus(struct worm* aworm);
-extern int showDialog(char* prompt1, char* prompt2);
+extern void relayoutMessageArea();
+extern void showStatus(struct worm_table* atable, int id);
+extern void showTickStatus(struct scheduler* asched);
+extern void showRenderStatus();
+extern void showAutopilotStatus(struct autopilot* apilot, long period_ns);
+extern void showProfile(struct profiler* aprof);
+extern void showNotice(char* text);
+extern void openDialog(struct board* aboard, enum DialogModes mode,
+                       char* prompt1, char* prompt2);
+extern void closeDialog(struct board* aboard);
+extern bool isDialogOpen();
+extern bool isDialogModal();
+extern void drawDialog();
+extern void relayoutDialog(struct board* aboard);
+extern void tickDialog(struct board* aboard);
 
 #endif  // #define _MESSAGES_H
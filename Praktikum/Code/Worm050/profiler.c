@@ -0,0 +1,139 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Timing of the phases of the game loop
+
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "profiler.h"
+#include "trace.h"
+#include "worm.h"
+
+#define NSEC_PER_SEC 1000000000L
+
+static long long nowNanoseconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+// Number of the bucket for a time of ns nanoseconds.
+// Buckets 0..3 hold 0..3 ns; above, each power of two has four buckets.
+static int bucketOf(long ns) {
+  int e = 2;
+  int bucket;
+
+  if (ns < 4) {
+    return ns < 0 ? 0 : (int)ns;
+  }
+  while (e < 62 && (ns >> (e + 1)) != 0) {
+    e++;
+  }
+  // e is the position of the highest bit; the next two bits select
+  bucket = 4 * (e - 1) + (int)((ns >> (e - 2)) & 3);
+  return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+// The largest time falling into bucket
+static long bucketLimit(int bucket) {
+  int e = bucket / 4 + 1;
+
+  if (bucket < 4) {
+    return bucket;
+  }
+  return ((long)(4 + bucket % 4) << (e - 2)) + (1L << (e - 2)) - 1;
+}
+
+// Add a tick to ahist; the oldest tick drops out of a full window
+static void addSample(struct profile_histogram* ahist, long ns) {
+  int bucket = bucketOf(ns);
+
+  if (ahist->count == PROFILE_WINDOW) {
+    ahist->counts[ahist->samples[ahist->next]]--;
+  } else {
+    ahist->count++;
+  }
+  ahist->samples[ahist->next] = bucket;
+  ahist->counts[bucket]++;
+  ahist->next = (ahist->next + 1) % PROFILE_WINDOW;
+}
+
+// Start profiling; the first phase starts now
+void initializeProfiler(struct profiler* aprof, long period_ns) {
+  memset(aprof, 0, sizeof(*aprof));
+  aprof->period_ns = period_ns;
+  aprof->tracer = NULL;
+  aprof->mark_ns = nowNanoseconds();
+  aprof->hud_ns = aprof->mark_ns;
+}
+
+// Pass all phases on to atracer as well (NULL: stop it)
+void setProfileTracer(struct profiler* aprof, struct tracer* atracer) {
+  aprof->tracer = atracer;
+}
+
+// The phase has ended now. A phase may end several times per tick
+// (e.g. input arriving between two ticks); the times add up.
+void endPhase(struct profiler* aprof, enum ProfilePhases phase) {
+  long long now = nowNanoseconds();
+
+  aprof->tick_ns[phase] += now - aprof->mark_ns;
+  if (aprof->tracer != NULL) {
+    traceEvent(aprof->tracer, phase, aprof->mark_ns, now, aprof->ticks);
+  }
+  aprof->mark_ns = now;
+}
+
+// The tick has ended: put its times into the histograms
+void endProfiledTick(struct profiler* aprof) {
+  long busy = 0;
+  int phase;
+
+  for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+    addSample(&aprof->phases[phase], aprof->tick_ns[phase]);
+    if (phase != PHASE_SLEEP) {
+      busy += aprof->tick_ns[phase];
+    }
+    aprof->tick_ns[phase] = 0;
+  }
+  addSample(&aprof->busy, busy);
+  aprof->ticks++;
+}
+
+// The time in ns that percent percent of the ticks in the window did not
+// exceed (rounded up to the limit of its bucket); 0 if there are no ticks
+long profilePercentile(const struct profile_histogram* ahist, int percent) {
+  // Rank of the tick we are looking for, counting from 1
+  int rank = (ahist->count * percent + 99) / 100;
+  int seen = 0;
+  int bucket;
+
+  if (rank < 1) {
+    rank = 1;
+  }
+  for (bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+    seen += ahist->counts[bucket];
+    if (seen >= rank) {
+      return bucketLimit(bucket);
+    }
+  }
+  return 0;
+}
+
+// Is it time to update the HUD? Limits the updates to one per
+// PROFILE_HUD_NS, so the display does not disturb what it shows.
+bool isProfileHudDue(struct profiler* aprof) {
+  if (aprof->mark_ns - aprof->hud_ns < PROFILE_HUD_NS) {
+    return false;
+  }
+  aprof->hud_ns = aprof->mark_ns;
+  return true;
+}
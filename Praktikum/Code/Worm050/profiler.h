@@ -0,0 +1,70 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Timing of the phases of the game loop
+//
+// The game loop marks the end of each phase; the time since the previous
+// mark is added to that phase. At the end of a tick the times of all
+// phases go into rolling histograms over the last PROFILE_WINDOW ticks.
+// The buckets of a histogram grow exponentially with four buckets per
+// power of two, so percentiles are accurate to about 25 percent.
+// If a tracer is set, every phase is also passed on to the trace.
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stdbool.h>
+#include "worm.h"
+
+struct tracer; // See trace.h
+
+#define PROFILE_WINDOW 256     // Number of ticks in the histograms
+#define PROFILE_BUCKETS 144    // Covers up to about a minute
+#define PROFILE_HUD_NS 250000000L // Minimal time between HUD updates
+
+// The phases of a tick in the order of the game loop
+enum ProfilePhases {
+  PHASE_INPUT,   // Reading keys and choosing the heading
+  PHASE_TAILS,   // Cleaning the tails of the worms
+  PHASE_MOVE,    // Moving the worms
+  PHASE_RENDER,  // Queueing the changes and the status for the display
+  PHASE_REFRESH, // Writing to the terminal
+  PHASE_SLEEP,   // Waiting for the next tick
+  NUMBER_OF_PHASES,
+};
+
+// The times of the last PROFILE_WINDOW ticks
+struct profile_histogram {
+  unsigned char samples[PROFILE_WINDOW]; // Bucket of each tick (a ring)
+  int counts[PROFILE_BUCKETS];           // Number of ticks per bucket
+  int next;                              // Slot for the next tick
+  int count;                             // Number of ticks in the window
+};
+
+struct profiler {
+  long period_ns;                 // Length of a tick: the frame budget
+  long long mark_ns;              // End of the last phase
+  long tick_ns[NUMBER_OF_PHASES]; // Times of the current tick so far
+  struct profile_histogram phases[NUMBER_OF_PHASES];
+  struct profile_histogram busy;  // All phases except the sleep
+  long long hud_ns;               // Time of the last HUD update
+  long ticks;                     // Number of ticks profiled
+  struct tracer* tracer;          // Receives the phases; NULL: none
+};
+
+extern void initializeProfiler(struct profiler* aprof, long period_ns);
+extern void setProfileTracer(struct profiler* aprof,
+                             struct tracer* atracer);
+extern void endPhase(struct profiler* aprof, enum ProfilePhases phase);
+extern void endProfiledTick(struct profiler* aprof);
+extern long profilePercentile(const struct profile_histogram* ahist,
+                              int percent);
+extern bool isProfileHudDue(struct profiler* aprof);
+
+#endif  // #define _PROFILER_H
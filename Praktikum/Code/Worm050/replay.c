@@ -0,0 +1,424 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Recording and replaying the input of a game
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay.h"
+#include "game.h"
+#include "state_buffer.h"
+#include "worm.h"
+#include "worm_model.h"
+
+static const char replay_magic[7] = {'W', 'O', 'R', 'M', 'R', 'P', 'L'};
+static const char index_magic[8] = {'W', 'O', 'R', 'M', 'I', 'D', 'X', '\0'};
+
+#define HEADER_SIZE (sizeof(replay_magic) + 1 + 3 * 4 + 2 * 8)
+#define TRAILER_SIZE (8 + sizeof(index_magic))
+#define INDEX_ENTRY_SIZE 16 // Tick and offset of a keyframe
+
+// ************************************
+// Recording
+// ************************************
+
+// Write value with 7 bits per byte; the high bit marks a following byte
+static bool writeVarint(FILE* file, uint64_t value) {
+  while (value >= 0x80) {
+    if (fputc((int)(value & 0x7f) | 0x80, file) == EOF) {
+      return false;
+    }
+    value >>= 7;
+  }
+  return fputc((int)value, file) != EOF;
+}
+
+// Create filename and write the settings of the game.
+// Must be called before the first tick. Every keyframe_interval ticks
+// the full state of the game is written (0: never).
+enum ResCodes startRecording(struct replay_recorder* arec,
+                             const char* filename, struct game* agame,
+                             long keyframe_interval) {
+  const struct game_settings* asettings = &agame->settings;
+  struct state_buffer header;
+
+  if (initializeStateBuffer(&header, HEADER_SIZE) != RES_OK) {
+    return RES_FAILED;
+  }
+  putBytes(&header, replay_magic, sizeof(replay_magic));
+  putUint8(&header, REPLAY_VERSION);
+  putUint32(&header, asettings->nrows);
+  putUint32(&header, asettings->ncols);
+  putUint32(&header, asettings->nworms);
+  putUint64(&header, (uint64_t)asettings->worm_length);
+  putUint64(&header, asettings->seed);
+
+  arec->file = fopen(filename, "wb");
+  if (arec->file == NULL) {
+    cleanupStateBuffer(&header);
+    return RES_FAILED;
+  }
+  if (header.failed ||
+      fwrite(header.data, header.size, 1, arec->file) != 1 ||
+      initializeStateBuffer(&arec->keyframe, 0) != RES_OK) {
+    cleanupStateBuffer(&header);
+    fclose(arec->file);
+    arec->file = NULL;
+    return RES_FAILED;
+  }
+  cleanupStateBuffer(&header);
+  if (initializeStateBuffer(&arec->index, 0) != RES_OK) {
+    cleanupStateBuffer(&arec->keyframe);
+    fclose(arec->file);
+    arec->file = NULL;
+    return RES_FAILED;
+  }
+  arec->last_tick = agame->tick;
+  arec->last_heading = getWormHeading(&agame->worms, USER_WORM_ID);
+  arec->keyframe_interval = keyframe_interval;
+  arec->nkeyframes = 0;
+  return RES_OK;
+}
+
+static enum ResCodes writeEvent(struct replay_recorder* arec, long tick,
+                                int code) {
+  if (!writeVarint(arec->file, (uint64_t)(tick - arec->last_tick)) ||
+      fputc(code, arec->file) == EOF) {
+    return RES_FAILED;
+  }
+  arec->last_tick = tick;
+  return RES_OK;
+}
+
+// Write the full state of the game and remember where it is
+static enum ResCodes writeKeyframe(struct replay_recorder* arec,
+                                   struct game* agame) {
+  long offset;
+
+  clearStateBuffer(&arec->keyframe);
+  saveGame(agame, &arec->keyframe);
+  if (arec->keyframe.failed ||
+      writeEvent(arec, agame->tick, REPLAY_KEYFRAME) != RES_OK ||
+      (offset = ftell(arec->file)) < 0 ||
+      !writeVarint(arec->file, arec->keyframe.size) ||
+      fwrite(arec->keyframe.data, arec->keyframe.size, 1, arec->file) != 1) {
+    return RES_FAILED;
+  }
+  putUint64(&arec->index, (uint64_t)agame->tick);
+  putUint64(&arec->index, (uint64_t)offset);
+  arec->nkeyframes++;
+  return arec->index.failed ? RES_FAILED : RES_OK;
+}
+
+// Record the input for the coming tick.
+// Called after the user's heading has been applied and before stepGame.
+enum ResCodes recordTick(struct replay_recorder* arec, struct game* agame) {
+  enum WormHeading dir = getWormHeading(&agame->worms, USER_WORM_ID);
+
+  if (arec->file == NULL) {
+    return RES_OK;
+  }
+  if (dir != arec->last_heading) {
+    arec->last_heading = dir;
+    if (writeEvent(arec, agame->tick, dir) != RES_OK) {
+      return RES_FAILED;
+    }
+  }
+  // The keyframe includes the heading just recorded
+  if (arec->keyframe_interval > 0 && agame->tick > 0 &&
+      agame->tick % arec->keyframe_interval == 0) {
+    return writeKeyframe(arec, agame);
+  }
+  return RES_OK;
+}
+
+// Record that the user ended the game before the coming tick
+enum ResCodes recordQuit(struct replay_recorder* arec, struct game* agame) {
+  if (arec->file == NULL) {
+    return RES_OK;
+  }
+  return writeEvent(arec, agame->tick, REPLAY_QUIT);
+}
+
+// Write the index and close the file.
+// Reports if any of the buffered writes failed.
+enum ResCodes stopRecording(struct replay_recorder* arec) {
+  enum ResCodes res_code = RES_OK;
+  struct state_buffer* aindex = &arec->index;
+  long index_offset;
+
+  if (arec->file == NULL) {
+    return RES_OK;
+  }
+  if (writeEvent(arec, arec->last_tick, REPLAY_END) != RES_OK ||
+      (index_offset = ftell(arec->file)) < 0) {
+    res_code = RES_FAILED;
+  } else {
+    // The entries have been collected while recording; put the count
+    // in front and the trailer behind them
+    struct state_buffer head;
+    if (initializeStateBuffer(&head, 8) != RES_OK) {
+      res_code = RES_FAILED;
+    } else {
+      putUint64(&head, (uint64_t)arec->nkeyframes);
+      putUint64(aindex, (uint64_t)index_offset);
+      putBytes(aindex, index_magic, sizeof(index_magic));
+      if (head.failed || aindex->failed ||
+          fwrite(head.data, head.size, 1, arec->file) != 1 ||
+          fwrite(aindex->data, aindex->size, 1, arec->file) != 1) {
+        res_code = RES_FAILED;
+      }
+      cleanupStateBuffer(&head);
+    }
+  }
+  if (ferror(arec->file)) {
+    res_code = RES_FAILED;
+  }
+  if (fclose(arec->file) != 0) {
+    res_code = RES_FAILED;
+  }
+  arec->file = NULL;
+  cleanupStateBuffer(&arec->keyframe);
+  cleanupStateBuffer(&arec->index);
+  return res_code;
+}
+
+// ************************************
+// Replaying
+// ************************************
+
+static uint64_t getLittleEndian(const unsigned char* p, int nbytes) {
+  uint64_t value = 0;
+  int i;
+  for (i = 0; i < nbytes; i++) {
+    value |= (uint64_t)p[i] << (8 * i);
+  }
+  return value;
+}
+
+// Read a number written by writeVarint at the current position
+static bool readVarint(struct replay_player* aplayer, uint64_t* avalue) {
+  uint64_t value = 0;
+  int shift;
+
+  for (shift = 0; shift < 64 && aplayer->pos < aplayer->size; shift += 7) {
+    unsigned char ch = aplayer->data[aplayer->pos++];
+    value |= (uint64_t)(ch & 0x7f) << shift;
+    if ((ch & 0x80) == 0) {
+      *avalue = value;
+      return true;
+    }
+  }
+  return false; // Truncated or corrupt file
+}
+
+// Fetch the next input event; keyframes on the way are skipped.
+// Marks the end of the replay if there is no further event. If the file
+// ends without REPLAY_END, e.g. because the recording game was killed,
+// the replay is marked as truncated; next_tick then is the tick of the
+// last event or keyframe found.
+static void readEvent(struct replay_player* aplayer) {
+  uint64_t delta, size;
+  int code;
+
+  for (;;) {
+    if (!readVarint(aplayer, &delta) || aplayer->pos == aplayer->size) {
+      aplayer->at_end = true;
+      aplayer->truncated = true;
+      return;
+    }
+    code = aplayer->data[aplayer->pos++];
+    aplayer->next_tick += (long)delta;
+    if (code != REPLAY_KEYFRAME) {
+      break;
+    }
+    if (!readVarint(aplayer, &size) || size > aplayer->size - aplayer->pos) {
+      aplayer->at_end = true;
+      aplayer->truncated = true;
+      return;
+    }
+    aplayer->pos += size;
+  }
+  if (code > REPLAY_QUIT) {
+    aplayer->at_end = true;
+    aplayer->truncated = code != REPLAY_END; // Garbage
+    return;
+  }
+  aplayer->next_code = code;
+}
+
+// Find the index of the keyframes through the trailer.
+// Files without a valid trailer are replayed from the beginning only.
+static void findIndex(struct replay_player* aplayer) {
+  const unsigned char* trailer;
+  uint64_t offset, count;
+
+  aplayer->index = NULL;
+  aplayer->nkeyframes = 0;
+  if (aplayer->size < HEADER_SIZE + TRAILER_SIZE) {
+    return;
+  }
+  trailer = aplayer->data + aplayer->size - TRAILER_SIZE;
+  if (memcmp(trailer + 8, index_magic, sizeof(index_magic)) != 0) {
+    return;
+  }
+  offset = getLittleEndian(trailer, 8);
+  if (offset < HEADER_SIZE || offset > aplayer->size - TRAILER_SIZE - 8) {
+    return;
+  }
+  count = getLittleEndian(aplayer->data + offset, 8);
+  if (count > (aplayer->size - TRAILER_SIZE - offset - 8) / INDEX_ENTRY_SIZE) {
+    return;
+  }
+  aplayer->index = aplayer->data + offset + 8;
+  aplayer->nkeyframes = (long)count;
+}
+
+// Map a replay file into memory and read the settings of the recorded game
+enum ResCodes openReplay(struct replay_player* aplayer, const char* filename) {
+  struct game_settings* asettings = &aplayer->settings;
+  struct stat st;
+  const unsigned char* p;
+  void* map;
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return RES_FAILED;
+  }
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)HEADER_SIZE) {
+    close(fd);
+    return RES_FAILED;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping stays valid
+  if (map == MAP_FAILED) {
+    return RES_FAILED;
+  }
+  aplayer->data = map;
+  aplayer->size = st.st_size;
+
+  p = aplayer->data;
+  if (memcmp(p, replay_magic, sizeof(replay_magic)) != 0 ||
+      p[sizeof(replay_magic)] < 1 ||
+      p[sizeof(replay_magic)] > REPLAY_VERSION) {
+    closeReplay(aplayer);
+    return RES_FAILED;
+  }
+  if (p[sizeof(replay_magic)] >= 2) {
+    findIndex(aplayer);
+  } else {
+    aplayer->index = NULL;
+    aplayer->nkeyframes = 0;
+  }
+  p += sizeof(replay_magic) + 1;
+  asettings->nrows = (int)getLittleEndian(p, 4);
+  asettings->ncols = (int)getLittleEndian(p + 4, 4);
+  asettings->nworms = (int)getLittleEndian(p + 8, 4);
+  asettings->worm_length = (long)getLittleEndian(p + 12, 8);
+  asettings->seed = getLittleEndian(p + 20, 8);
+  if (!isValidBoardSize(asettings->nrows, asettings->ncols,
+                        MAX_BOARD_CELLS)) {
+    closeReplay(aplayer);
+    return RES_FAILED;
+  }
+
+  aplayer->pos = HEADER_SIZE;
+  aplayer->next_tick = 0;
+  aplayer->at_end = false;
+  aplayer->truncated = false;
+  readEvent(aplayer);
+  return RES_OK;
+}
+
+// Jump to the last keyframe at or before tick, if that is ahead of agame.
+// The keyframes are sorted by tick; a binary search finds the right one.
+// Afterwards the caller steps agame up to tick as usual.
+// On failure agame is in an undefined state and must be cleaned up.
+enum ResCodes seekReplay(struct replay_player* aplayer, struct game* agame,
+                         long tick) {
+  long lo = 0;
+  long hi = aplayer->nkeyframes; // Keyframes lo..hi-1 are candidates
+  long kf_tick;
+  uint64_t offset, size;
+  struct state_buffer buf;
+
+  while (lo < hi) {
+    long mid = lo + (hi - lo) / 2;
+    if ((long)getLittleEndian(aplayer->index + mid * INDEX_ENTRY_SIZE, 8) <=
+        tick) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return RES_OK; // No keyframe before tick: start from the beginning
+  }
+  kf_tick = (long)getLittleEndian(aplayer->index + (lo - 1) * INDEX_ENTRY_SIZE,
+                                  8);
+  offset =
+      getLittleEndian(aplayer->index + (lo - 1) * INDEX_ENTRY_SIZE + 8, 8);
+  if (kf_tick <= agame->tick) {
+    return RES_OK; // We are closer already
+  }
+  if (offset >= aplayer->size) {
+    return RES_FAILED;
+  }
+  aplayer->pos = offset;
+  if (!readVarint(aplayer, &size) || size > aplayer->size - aplayer->pos) {
+    return RES_FAILED;
+  }
+  viewStateBuffer(&buf, aplayer->data + aplayer->pos, size);
+  if (loadGame(agame, &buf) != RES_OK || agame->tick != kf_tick) {
+    return RES_FAILED;
+  }
+  // Continue with the events after the keyframe
+  aplayer->pos += size;
+  aplayer->next_tick = kf_tick;
+  aplayer->at_end = false;
+  aplayer->truncated = false;
+  readEvent(aplayer);
+  return RES_OK;
+}
+
+// Apply the recorded input for the coming tick of agame.
+// Called instead of processing user input, right before stepGame.
+void replayTick(struct replay_player* aplayer, struct game* agame) {
+  while (!aplayer->at_end && aplayer->next_tick == agame->tick) {
+    if (aplayer->next_code == REPLAY_QUIT) {
+      agame->game_state = WORM_GAME_QUIT;
+    } else {
+      setWormHeading(&agame->worms, USER_WORM_ID,
+                     (enum WormHeading)aplayer->next_code);
+    }
+    readEvent(aplayer);
+  }
+}
+
+// Is the input for the coming tick of agame known?
+// After a clean end of the recording there is no more input to come, and
+// the game runs on until the user worm dies. A truncated recording only
+// knows the input up to its last event or keyframe.
+bool hasReplayInput(struct replay_player* aplayer, struct game* agame) {
+  return !aplayer->truncated || agame->tick < aplayer->next_tick;
+}
+
+void closeReplay(struct replay_player* aplayer) {
+  if (aplayer->data != NULL) {
+    munmap((void*)aplayer->data, aplayer->size);
+    aplayer->data = NULL;
+  }
+}
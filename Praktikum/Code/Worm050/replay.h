@@ -0,0 +1,92 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Recording and replaying the input of a game
+//
+// A game is fully determined by its settings and the headings the user
+// chooses. A replay file stores the settings once, followed by one event
+// per change of the user worm's heading and a final event if the user quits.
+// Every so many ticks a keyframe holds the full state of the game; a
+// trailing index of the keyframes lets a replay start near any tick.
+//
+// Format (all numbers little endian):
+//   header:   magic "WORMRPL", version byte,
+//             rows, cols, worms (u32), worm length, seed (u64)
+//   events:   ticks since the previous event (LEB128), event code (1 byte)
+//             a keyframe event is followed by the size of the saved game
+//             (LEB128) and the saved game (see saveGame)
+//   end:      event REPLAY_END
+//   index:    number of keyframes (u64), per keyframe its tick and the
+//             offset of its size field (u64 each)
+//   trailer:  offset of the index (u64), magic "WORMIDX\0"
+// Version 1 files consist of header and events only.
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "worm.h"
+#include "worm_model.h"
+#include "game.h"
+#include "state_buffer.h"
+
+#define REPLAY_VERSION 2
+
+// Event codes; codes below REPLAY_QUIT are the new heading of the user worm
+#define REPLAY_QUIT 4     // The user ended the game
+#define REPLAY_KEYFRAME 5 // The full state of the game at this tick
+#define REPLAY_END 6      // No more events; the index follows
+
+#define REPLAY_KEYFRAME_INTERVAL 1000 // Default number of ticks per keyframe
+
+struct replay_recorder {
+  FILE* file;
+  long last_tick;                // Tick of the last event written
+  enum WormHeading last_heading; // Heading of the user worm at that time
+  long keyframe_interval;        // Ticks between keyframes; 0: none
+  struct state_buffer keyframe;  // Reused for each keyframe
+  struct state_buffer index;     // Ticks and offsets of all keyframes
+  long nkeyframes;               // Number of entries in index
+};
+
+struct replay_player {
+  const unsigned char* data;     // The mapped file
+  size_t size;                   // Size of the file
+  size_t pos;                    // Offset of the next event
+  struct game_settings settings; // Settings of the recorded game
+  long next_tick;                // Tick of the next event
+  int next_code;                 // Code of the next event
+  bool at_end;                   // No more events
+  bool truncated;                // The file ends before REPLAY_END
+  const unsigned char* index;    // Index of the keyframes; NULL: none
+  long nkeyframes;               // Number of entries in index
+};
+
+extern enum ResCodes startRecording(struct replay_recorder* arec,
+                                    const char* filename,
+                                    struct game* agame,
+                                    long keyframe_interval);
+extern enum ResCodes recordTick(struct replay_recorder* arec,
+                                struct game* agame);
+extern enum ResCodes recordQuit(struct replay_recorder* arec,
+                                struct game* agame);
+extern enum ResCodes stopRecording(struct replay_recorder* arec);
+
+extern enum ResCodes openReplay(struct replay_player* aplayer,
+                                const char* filename);
+extern enum ResCodes seekReplay(struct replay_player* aplayer,
+                                struct game* agame, long tick);
+extern void replayTick(struct replay_player* aplayer, struct game* agame);
+extern bool hasReplayInput(struct replay_player* aplayer,
+                           struct game* agame);
+extern void closeReplay(struct replay_player* aplayer);
+
+#endif  // #define _REPLAY_H
@@ -0,0 +1,36 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A small deterministic pseudo random number generator (xorshift64*)
+
+#include <stdint.h>
+
+#include "rng.h"
+
+void seedRng(struct rng* arng, uint64_t seed) {
+  // Spread the bits of small seeds; the state must never be 0
+  arng->state = seed * 0x9E3779B97F4A7C15ULL;
+  if (arng->state == 0) {
+    arng->state = 0x9E3779B97F4A7C15ULL;
+  }
+}
+
+uint64_t nextRandom(struct rng* arng) {
+  uint64_t x = arng->state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  arng->state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+// A random number in 0..n-1 (n > 0)
+int randomBelow(struct rng* arng, int n) {
+  return (int)((nextRandom(arng) >> 32) % (uint64_t)n);
+}
@@ -0,0 +1,26 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A small deterministic pseudo random number generator (xorshift64*).
+// The same seed always yields the same game.
+
+#ifndef _RNG_H
+#define _RNG_H
+
+#include <stdint.h>
+
+struct rng {
+  uint64_t state; // Never 0
+};
+
+extern void seedRng(struct rng* arng, uint64_t seed);
+extern uint64_t nextRandom(struct rng* arng);
+extern int randomBelow(struct rng* arng, int n);
+
+#endif  // #define _RNG_H
@@ -0,0 +1,157 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Fixed timestep scheduling of the game loop
+
+#define _GNU_SOURCE // For ppoll
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#include "scheduler.h"
+#include "worm.h"
+
+#define NSEC_PER_SEC 1000000000L
+#define NSEC_PER_MSEC 1000000L
+
+// Add ns nanoseconds to *ts
+static void addNanoseconds(struct timespec* ts, long long ns) {
+  long long total = ts->tv_nsec + ns;
+  ts->tv_sec += total / NSEC_PER_SEC;
+  ts->tv_nsec = total % NSEC_PER_SEC;
+}
+
+// Nanoseconds from a to b (negative if b is before a)
+static long long diffNanoseconds(const struct timespec* a,
+                                 const struct timespec* b) {
+  return (long long)(b->tv_sec - a->tv_sec) * NSEC_PER_SEC +
+         (b->tv_nsec - a->tv_nsec);
+}
+
+// Set up a scheduler with the given tick rate.
+// The first tick is due one period from now.
+// SIGWINCH is blocked by the display outside of waiting (see display.h);
+// we only let it in while we sleep.
+enum ResCodes initializeScheduler(struct scheduler* asched,
+                                  int ticks_per_second) {
+  if (ticks_per_second < 1) {
+    return RES_FAILED;
+  }
+  asched->period_ns = NSEC_PER_SEC / ticks_per_second;
+  asched->late_ticks = 0;
+  asched->skipped_ticks = 0;
+  pthread_sigmask(SIG_BLOCK, NULL, &asched->wait_mask);
+  sigdelset(&asched->wait_mask, SIGWINCH);
+  restartScheduler(asched);
+  return RES_OK;
+}
+
+// Let the next tick be due one period from now
+// (e.g. after the game has been paused)
+void restartScheduler(struct scheduler* asched) {
+  clock_gettime(CLOCK_MONOTONIC, &asched->deadline);
+  addNanoseconds(&asched->deadline, asched->period_ns);
+}
+
+// The work of the current tick is done: compute the deadline of the next one.
+// If that deadline has passed already, the next tick is late and runs at once
+// so that the following ticks catch up. If we are behind by more than
+// MAX_CATCHUP_TICKS periods, the missed ticks are skipped.
+void finishTick(struct scheduler* asched) {
+  struct timespec now;
+  long long behind_ns;
+
+  addNanoseconds(&asched->deadline, asched->period_ns);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  behind_ns = diffNanoseconds(&asched->deadline, &now);
+
+  if (behind_ns <= 0) {
+    return; // In time
+  }
+
+  // Overrun: the next tick is late
+  asched->late_ticks++;
+  if (behind_ns > (long long)MAX_CATCHUP_TICKS * asched->period_ns) {
+    // Too far behind: drop the missed periods but keep the phase
+    long long missed = behind_ns / asched->period_ns;
+    asched->skipped_ticks += missed;
+    addNanoseconds(&asched->deadline, missed * asched->period_ns);
+  }
+}
+
+#ifndef __linux__
+// Poll with the signal mask mask. Without ppoll a signal that comes just
+// before poll is only seen when poll returns.
+static int pollWithMask(struct pollfd* pfd, int timeout_ms,
+                        const sigset_t* mask) {
+  sigset_t old;
+  int res;
+
+  pthread_sigmask(SIG_SETMASK, mask, &old);
+  res = poll(pfd, 1, timeout_ms);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  return res;
+}
+#endif
+
+// Sleep until the next tick is due or fd becomes readable.
+// With no_deadline set we only wait for fd (e.g. in single step mode).
+// The process does not use any CPU while waiting.
+enum SchedulerEvents waitForTickOrInput(struct scheduler* asched, int fd,
+                                        bool no_deadline) {
+  struct pollfd pfd;
+  struct timespec now;
+  long long remaining_ns;
+  int res;
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+
+  while (true) {
+    if (no_deadline) {
+#ifdef __linux__
+      res = ppoll(&pfd, 1, NULL, &asched->wait_mask);
+#else
+      res = pollWithMask(&pfd, -1, &asched->wait_mask);
+#endif
+    } else {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      remaining_ns = diffNanoseconds(&now, &asched->deadline);
+      if (remaining_ns <= 0) {
+        return SCHED_TICK_DUE;
+      }
+#ifdef __linux__
+      {
+        struct timespec timeout;
+        timeout.tv_sec = remaining_ns / NSEC_PER_SEC;
+        timeout.tv_nsec = remaining_ns % NSEC_PER_SEC;
+        res = ppoll(&pfd, 1, &timeout, &asched->wait_mask);
+      }
+#else
+      // Round up: we may wake up to a millisecond late, but never early
+      res = pollWithMask(&pfd, (int)((remaining_ns + NSEC_PER_MSEC - 1) /
+                                     NSEC_PER_MSEC), &asched->wait_mask);
+#endif
+    }
+    if (res > 0) {
+      return SCHED_INPUT_READY;
+    }
+    if (res < 0 && errno == EINTR) {
+      // Let the caller look at what the signal has brought
+      return SCHED_INTERRUPTED;
+    }
+    if (res < 0) {
+      // Polling is broken; fall back to ticking
+      return SCHED_TICK_DUE;
+    }
+    // Timeout: check the deadline again
+  }
+}
@@ -0,0 +1,52 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Fixed timestep scheduling of the game loop
+//
+// Ticks are due at absolute points in time on CLOCK_MONOTONIC.
+// The time spent for simulation and rendering does not shift the
+// deadlines, thus the tick period does not drift.
+// While waiting for the next tick we also wait for user input, so
+// key presses are processed as soon as they arrive.
+
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+#include "worm.h"
+
+// If we are behind by more than this many periods, we skip the missed
+// ticks instead of running them back-to-back
+#define MAX_CATCHUP_TICKS 5
+
+// Why waitForTickOrInput returned
+enum SchedulerEvents {
+  SCHED_TICK_DUE,
+  SCHED_INPUT_READY,
+  SCHED_INTERRUPTED, // A signal has arrived (e.g. SIGWINCH)
+};
+
+struct scheduler {
+  long period_ns;          // Length of a tick in nanoseconds
+  struct timespec deadline; // Absolute time at which the next tick is due
+  long late_ticks;         // Ticks whose deadline had passed already
+  long skipped_ticks;      // Ticks dropped because we were too far behind
+  sigset_t wait_mask;      // Signal mask while waiting: lets SIGWINCH in
+};
+
+extern enum ResCodes initializeScheduler(struct scheduler* asched,
+                                         int ticks_per_second);
+extern void restartScheduler(struct scheduler* asched);
+extern void finishTick(struct scheduler* asched);
+extern enum SchedulerEvents waitForTickOrInput(struct scheduler* asched,
+                                               int fd, bool no_deadline);
+
+#endif  // #define _SCHEDULER_H
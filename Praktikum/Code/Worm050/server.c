@@ -0,0 +1,693 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The worm server: several players on one board
+//
+// The server owns the board and the worms; the clients (see client.c) only
+// show what the server sends. Each client that connects gets a worm of its
+// own and sends the heading changes of its player. The server runs the ticks
+// in lockstep for all worms: heading changes are applied at most one per
+// tick and worm, like the keys of the local game (see input_queue.h).
+//
+// One thread serves all clients. The sockets are non-blocking and watched
+// by an epoll instance; the scheduler waits for the epoll descriptor and
+// the deadline of the next tick at the same time.
+//
+// After each tick the changed cells are encoded once into a frame (see
+// wire.h). Each client gets the frame and the status of its worm by a
+// single writev. If the socket cannot take it all, the rest is buffered
+// and written when the socket becomes writable again. A client that falls
+// behind by more than SERVER_MAX_BACKLOG bytes is disconnected; a slow
+// client never delays the tick of the others.
+
+#define _GNU_SOURCE // For accept4
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "worm.h"
+#include "board_model.h"
+#include "game.h"
+#include "input_queue.h"
+#include "profiler.h"
+#include "rng.h"
+#include "scheduler.h"
+#include "state_buffer.h"
+#include "wire.h"
+#include "worm_model.h"
+
+#define SERVER_RATE 60          // Default ticks per second
+#define SERVER_ROWS 100         // Default size of the board
+#define SERVER_COLS 300
+#define SERVER_MAX_CELLS (1L << 24) // Upper bound for rows * cols of --board
+#define SERVER_CLIENTS 64       // Default maximal number of clients
+#define SERVER_MAX_CLIENTS 1024 // Upper bound for --clients
+#define SERVER_WORM_CAPACITY 4096 // Worms per round, dead ones included
+#define SERVER_MAX_BACKLOG (1 << 20) // Bytes a client may fall behind
+#define SERVER_MAX_EVENTS 64    // Events taken from epoll at once
+#define SERVER_SNAPSHOT_CELLS 4096 // Cells encoded at once for a new client
+#define SERVER_STATS_SECONDS 5  // Time between two lines of statistics
+#define SERVER_READ_SIZE 256    // Bytes read from a client at once
+
+// Settings from the command line
+struct options {
+  char* socket_path;    // Where the clients connect
+  int ticks_per_second; // Tick rate of the game
+  int max_clients;      // More clients are rejected
+  int nrows;            // Size of the board
+  int ncols;
+  long worm_length;     // Length of the worms when fully grown
+  uint64_t seed;        // Seed for placing the worms
+};
+
+// A connected player
+struct client {
+  int fd;                      // The socket; -1: the slot is free
+  int id;                      // Id of the client's worm
+  struct input_queue inputq;   // Heading changes not yet applied
+  unsigned char in[WIRE_HEADER_SIZE]; // A message not received completely
+  int in_len;                  // Number of bytes in in
+  struct state_buffer out;     // Bytes not written yet, from out.pos on
+};
+
+// Everything the server works on
+struct server {
+  struct options* opts;
+  struct board board;
+  struct worm_table worms;
+  struct rng rng;
+  int listen_fd;
+  int epoll_fd;
+  struct client* clients;      // opts->max_clients slots
+  int nclients;                // Number of slots in use
+  long tick;                   // Number of ticks done in this round
+  struct state_buffer frame;   // The changed cells of the current tick
+  struct state_buffer status;  // The status of one worm
+};
+
+// Set by SIGINT and SIGTERM
+static volatile sig_atomic_t stop_requested = 0;
+
+void handleStopSignal(int signum);
+enum ResCodes startRound(struct server* aserver);
+enum ResCodes openListenSocket(struct server* aserver);
+void dropClient(struct server* aserver, struct client* aclient);
+void flushClient(struct server* aserver, struct client* aclient);
+void sendToClient(struct server* aserver, struct client* aclient);
+void acceptClients(struct server* aserver);
+void readClient(struct server* aserver, struct client* aclient);
+void processEvents(struct server* aserver);
+void stepServer(struct server* aserver, struct profiler* aprof);
+void showServerStats(struct server* aserver, struct scheduler* asched,
+                     struct profiler* aprof);
+void serveClients(struct server* aserver);
+enum ResCodes runServer(struct options* opts);
+void printUsage(char* progname);
+bool parseNumber(char* arg, long min, long* result);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
+
+void handleStopSignal(int signum) {
+  stop_requested = 1;
+}
+
+// ************************************
+// The game
+// ************************************
+
+// Begin with an empty board. Called at start and whenever the last client
+// has left; thus the slots of dead worms are used again.
+enum ResCodes startRound(struct server* aserver) {
+  cleanupWormTable(&aserver->worms);
+  cleanupBoard(&aserver->board);
+  if (initializeBoard(&aserver->board, aserver->opts->nrows,
+                      aserver->opts->ncols) != RES_OK ||
+      enableFreeCells(&aserver->board) != RES_OK) {
+    cleanupBoard(&aserver->board);
+    return RES_FAILED;
+  }
+  if (initializeWormTable(&aserver->worms, SERVER_WORM_CAPACITY) != RES_OK) {
+    cleanupBoard(&aserver->board);
+    return RES_FAILED;
+  }
+  aserver->tick = 0;
+  return RES_OK;
+}
+
+// Put a new worm onto a random free cell, heading for the wider side of
+// the board. Returns its id or -1 if there is no room.
+// The board keeps its free cells (see enableFreeCells in startRound); thus
+// a crowded board costs no more than an empty one.
+static int addPlayerWorm(struct server* aserver) {
+  struct board* aboard = &aserver->board;
+  struct pos headpos;
+  int id;
+
+  if (!randomFreeCell(aboard, &aserver->rng, &headpos)) {
+    return -1; // The board is full
+  }
+  id = addWorm(&aserver->worms, aserver->opts->worm_length, headpos,
+               2 * headpos.x < getLastCol(aboard) ? WORM_RIGHT : WORM_LEFT,
+               COLP_USER_WORM);
+  if (id >= 0) {
+    showWorm(aboard, &aserver->worms, id);
+  }
+  return id;
+}
+
+// One tick of the game for all worms
+void stepServer(struct server* aserver, struct profiler* aprof) {
+  int i;
+
+  cleanWormTails(&aserver->board, &aserver->worms);
+  endPhase(aprof, PHASE_TAILS);
+  for (i = 0; i < aserver->opts->max_clients; i++) {
+    struct client* aclient = &aserver->clients[i];
+    if (aclient->fd >= 0 &&
+        getWormState(&aserver->worms, aclient->id) == WORM_GAME_ONGOING) {
+      applyNextHeading(&aclient->inputq, &aserver->worms, aclient->id);
+    }
+  }
+  moveWorms(&aserver->board, &aserver->worms);
+  showWorms(&aserver->board, &aserver->worms);
+  aserver->tick++;
+  endPhase(aprof, PHASE_MOVE);
+
+  // Encode the changes once for all clients.
+  // Changes made between the ticks (new worms) go out with this tick.
+  clearStateBuffer(&aserver->frame);
+  putWireCells(&aserver->frame, aserver->board.changes.cells,
+               aserver->board.changes.count, aserver->tick);
+  clearChanges(&aserver->board);
+  for (i = 0; i < aserver->opts->max_clients; i++) {
+    if (aserver->clients[i].fd >= 0) {
+      sendToClient(aserver, &aserver->clients[i]);
+    }
+  }
+  endPhase(aprof, PHASE_RENDER);
+}
+
+// ************************************
+// The clients
+// ************************************
+
+// Close the connection; the worm of the client leaves the board
+void dropClient(struct server* aserver, struct client* aclient) {
+  if (getWormState(&aserver->worms, aclient->id) == WORM_GAME_ONGOING) {
+    setWormState(&aserver->worms, aclient->id, WORM_GAME_QUIT);
+  }
+  close(aclient->fd); // Also removes the socket from the epoll set
+  aclient->fd = -1;
+  cleanupStateBuffer(&aclient->out);
+  aserver->nclients--;
+  if (aserver->nclients == 0 && startRound(aserver) != RES_OK) {
+    fprintf(stderr, "Kein Speicher fuer eine neue Runde\n");
+    stop_requested = 1;
+  }
+}
+
+// Write as much of the buffered output as the socket takes
+void flushClient(struct server* aserver, struct client* aclient) {
+  struct state_buffer* aout = &aclient->out;
+
+  while (aout->pos < aout->size) {
+    ssize_t n = write(aclient->fd, aout->data + aout->pos,
+                      aout->size - aout->pos);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        dropClient(aserver, aclient);
+      }
+      return; // The rest is written when the socket is writable again
+    }
+    aout->pos += n;
+  }
+  clearStateBuffer(aout);
+}
+
+// Send the frame of the current tick and the status of the client's worm.
+// Both go out by one system call unless older output is still pending.
+void sendToClient(struct server* aserver, struct client* aclient) {
+  struct state_buffer* aout = &aclient->out;
+  struct wire_status status;
+  struct iovec iov[2];
+  size_t total;
+  ssize_t n = 0;
+
+  status.state = getWormState(&aserver->worms, aclient->id);
+  status.headpos = getWormHeadPos(&aserver->worms, aclient->id);
+  status.length = getWormLength(&aserver->worms, aclient->id);
+  clearStateBuffer(&aserver->status);
+  putWireStatus(&aserver->status, &status, aserver->tick);
+
+  iov[0].iov_base = aserver->frame.data;
+  iov[0].iov_len = aserver->frame.size;
+  iov[1].iov_base = aserver->status.data;
+  iov[1].iov_len = aserver->status.size;
+  total = iov[0].iov_len + iov[1].iov_len;
+
+  if (aout->pos == aout->size) {
+    // Nothing pending: straight from the frame to the socket
+    n = writev(aclient->fd, iov, 2);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      dropClient(aserver, aclient);
+      return;
+    }
+    if (n == (ssize_t)total) {
+      return;
+    }
+    if (n < 0) {
+      n = 0;
+    }
+    clearStateBuffer(aout);
+  } else if (aout->pos > 0) {
+    // Move the pending bytes to the front before appending
+    memmove(aout->data, aout->data + aout->pos, aout->size - aout->pos);
+    aout->size -= aout->pos;
+    aout->pos = 0;
+  }
+  if (aout->size + total - n > SERVER_MAX_BACKLOG) {
+    fprintf(stderr, "Client %d ist zu langsam und wird getrennt\n",
+            aclient->id);
+    dropClient(aserver, aclient);
+    return;
+  }
+  // Keep what has not been written in the order of the stream
+  if ((size_t)n < iov[0].iov_len) {
+    putBytes(aout, (unsigned char*)iov[0].iov_base + n, iov[0].iov_len - n);
+    n = 0;
+  } else {
+    n -= iov[0].iov_len;
+  }
+  putBytes(aout, (unsigned char*)iov[1].iov_base + n, iov[1].iov_len - n);
+  if (aout->failed) {
+    dropClient(aserver, aclient);
+  }
+}
+
+// Tell the new client about its worm and show it the whole board
+static void welcomeClient(struct server* aserver, struct client* aclient) {
+  struct board* aboard = &aserver->board;
+  struct cell_change cells[SERVER_SNAPSHOT_CELLS];
+  struct wire_welcome welcome;
+  int ncells = 0;
+  int y, x;
+
+  welcome.nrows = getLastRow(aboard) + 1;
+  welcome.ncols = getLastCol(aboard) + 1;
+  welcome.id = aclient->id;
+  welcome.ticks_per_second = aserver->opts->ticks_per_second;
+  putWireWelcome(&aclient->out, &welcome, aserver->tick);
+
+  // The client starts with an empty board: send the occupied cells only
+  for (y = 0; y <= getLastRow(aboard); y++) {
+    for (x = 0; x <= getLastCol(aboard); x++) {
+      if (getContentAt(aboard, y, x) != BC_FREE_CELL) {
+        struct look look = getLookAt(aboard, y, x);
+        cells[ncells].y = y;
+        cells[ncells].x = x;
+        cells[ncells].symbol = look.symbol;
+        cells[ncells].color_pair = look.color_pair;
+        if (++ncells == SERVER_SNAPSHOT_CELLS) {
+          putWireCells(&aclient->out, cells, ncells, aserver->tick);
+          ncells = 0;
+        }
+      }
+    }
+  }
+  putWireCells(&aclient->out, cells, ncells, aserver->tick);
+}
+
+// Refuse a client and close the connection at once
+static void rejectClient(struct server* aserver, int fd) {
+  clearStateBuffer(&aserver->status);
+  putWireHeader(&aserver->status, WIRE_REJECT, 0, 0, aserver->tick);
+  if (write(fd, aserver->status.data, aserver->status.size) < 0) {
+    // The client is gone already
+  }
+  close(fd);
+}
+
+// Take all pending connections
+void acceptClients(struct server* aserver) {
+  struct epoll_event event;
+  int fd, slot;
+
+  while ((fd = accept4(aserver->listen_fd, NULL, NULL,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    struct client* aclient;
+    int id;
+
+    if (aserver->nclients == aserver->opts->max_clients ||
+        (id = addPlayerWorm(aserver)) < 0) {
+      rejectClient(aserver, fd);
+      continue;
+    }
+    for (slot = 0; aserver->clients[slot].fd >= 0; slot++) {
+      // A free slot exists since nclients < max_clients
+    }
+    aclient = &aserver->clients[slot];
+    if (initializeStateBuffer(&aclient->out, 4096) != RES_OK) {
+      setWormState(&aserver->worms, id, WORM_GAME_QUIT);
+      rejectClient(aserver, fd);
+      continue;
+    }
+    aclient->fd = fd;
+    aclient->id = id;
+    aclient->in_len = 0;
+    initializeInputQueue(&aclient->inputq);
+    aserver->nclients++;
+
+    // Edge triggered: the interest list never has to change
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.u32 = slot;
+    if (epoll_ctl(aserver->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      dropClient(aserver, aclient);
+      continue;
+    }
+    welcomeClient(aserver, aclient);
+    flushClient(aserver, aclient);
+  }
+}
+
+// Read all heading changes the client has sent
+void readClient(struct server* aserver, struct client* aclient) {
+  unsigned char data[SERVER_READ_SIZE];
+  ssize_t n;
+  int i;
+
+  while (aclient->fd >= 0) {
+    n = read(aclient->fd, data, sizeof(data));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n <= 0) {
+      dropClient(aserver, aclient); // Gone or broken
+      return;
+    }
+    for (i = 0; i < n; i++) {
+      aclient->in[aclient->in_len++] = data[i];
+      if (aclient->in_len < WIRE_HEADER_SIZE) {
+        continue;
+      }
+      aclient->in_len = 0;
+      if (aclient->in[0] != WIRE_HEADING || aclient->in[1] > WORM_RIGHT) {
+        fprintf(stderr, "Client %d: ungueltige Nachricht\n", aclient->id);
+        dropClient(aserver, aclient);
+        return;
+      }
+      // A full queue drops the key, like a local keyboard would
+      enqueueHeading(&aclient->inputq, (enum WormHeading)aclient->in[1]);
+    }
+  }
+}
+
+// Handle everything epoll has for us; does not wait
+void processEvents(struct server* aserver) {
+  struct epoll_event events[SERVER_MAX_EVENTS];
+  int n, i;
+
+  do {
+    n = epoll_wait(aserver->epoll_fd, events, SERVER_MAX_EVENTS, 0);
+    for (i = 0; i < n; i++) {
+      struct client* aclient;
+
+      if (events[i].data.u32 == (uint32_t)aserver->opts->max_clients) {
+        acceptClients(aserver);
+        continue;
+      }
+      aclient = &aserver->clients[events[i].data.u32];
+      if (aclient->fd >= 0 && (events[i].events & EPOLLOUT)) {
+        flushClient(aserver, aclient);
+      }
+      if (aclient->fd >= 0 && (events[i].events & (EPOLLIN | EPOLLERR |
+                                                   EPOLLHUP))) {
+        readClient(aserver, aclient);
+      }
+    }
+  } while (n == SERVER_MAX_EVENTS);
+}
+
+// ************************************
+// Setup and main loop
+// ************************************
+
+// Create the socket the clients connect to.
+// A stale socket file is replaced, a running server is not.
+enum ResCodes openListenSocket(struct server* aserver) {
+  struct sockaddr_un addr;
+  struct epoll_event event;
+  int fd;
+
+  if (strlen(aserver->opts->socket_path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Pfad des Sockets zu lang: %s\n",
+            aserver->opts->socket_path);
+    return RES_FAILED;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, aserver->opts->socket_path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return RES_FAILED;
+  }
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+    fprintf(stderr, "Auf %s laeuft bereits ein Server\n", addr.sun_path);
+    close(fd);
+    return RES_FAILED;
+  }
+  close(fd);
+  unlink(addr.sun_path);
+
+  aserver->listen_fd =
+      socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (aserver->listen_fd < 0 ||
+      bind(aserver->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(aserver->listen_fd, SOMAXCONN) != 0) {
+    perror(addr.sun_path);
+    if (aserver->listen_fd >= 0) {
+      close(aserver->listen_fd);
+    }
+    return RES_FAILED;
+  }
+  event.events = EPOLLIN;
+  event.data.u32 = aserver->opts->max_clients; // Not a slot of a client
+  if (epoll_ctl(aserver->epoll_fd, EPOLL_CTL_ADD, aserver->listen_fd,
+                &event) != 0) {
+    perror("epoll_ctl");
+    close(aserver->listen_fd);
+    unlink(addr.sun_path);
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// A line about the load of the server on stderr
+void showServerStats(struct server* aserver, struct scheduler* asched,
+                     struct profiler* aprof) {
+  fprintf(stderr,
+          "Tick %ld: %d Clients, Arbeit je Tick p50 %ld us p99 %ld us, "
+          "verspaetet %ld, uebersprungen %ld\n",
+          aserver->tick, aserver->nclients,
+          profilePercentile(&aprof->busy, 50) / 1000,
+          profilePercentile(&aprof->busy, 99) / 1000, asched->late_ticks,
+          asched->skipped_ticks);
+}
+
+// The main loop: tick until SIGINT or SIGTERM arrives
+void serveClients(struct server* aserver) {
+  struct options* opts = aserver->opts;
+  struct scheduler sched;   // Deadlines of the ticks
+  struct profiler profiler; // Times the phases of the ticks
+  struct sigaction action;
+  long stats_ticks;
+  int i;
+
+  // Writes to a client that has gone must not kill the server;
+  // SIGINT and SIGTERM end the loop
+  signal(SIGPIPE, SIG_IGN);
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleStopSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  fprintf(stderr, "Server auf %s: Spielfeld %dx%d, %d Ticks/s, %d Clients\n",
+          opts->socket_path, opts->nrows, opts->ncols,
+          opts->ticks_per_second, opts->max_clients);
+  initializeScheduler(&sched, opts->ticks_per_second);
+  initializeProfiler(&profiler, sched.period_ns);
+  stats_ticks = (long)SERVER_STATS_SECONDS * opts->ticks_per_second;
+
+  while (!stop_requested) {
+    // The epoll descriptor is readable when any socket has an event
+    enum SchedulerEvents event =
+        waitForTickOrInput(&sched, aserver->epoll_fd, false);
+    endPhase(&profiler, PHASE_SLEEP);
+    if (event == SCHED_INTERRUPTED) {
+      continue; // Check for the stop request
+    }
+    if (event == SCHED_INPUT_READY) {
+      processEvents(aserver);
+      endPhase(&profiler, PHASE_INPUT);
+      continue; // Wait for the tick
+    }
+    // Without players the board stands still
+    if (aserver->nclients > 0) {
+      stepServer(aserver, &profiler);
+      if (aserver->tick % stats_ticks == 0) {
+        showServerStats(aserver, &sched, &profiler);
+      }
+    }
+    endProfiledTick(&profiler);
+    finishTick(&sched);
+  }
+
+  for (i = 0; i < opts->max_clients; i++) {
+    if (aserver->clients[i].fd >= 0) {
+      close(aserver->clients[i].fd);
+      cleanupStateBuffer(&aserver->clients[i].out);
+    }
+  }
+}
+
+enum ResCodes runServer(struct options* opts) {
+  struct server theserver;
+  enum ResCodes res_code = RES_FAILED;
+  int i;
+
+  theserver.opts = opts;
+  seedRng(&theserver.rng, opts->seed);
+  theserver.nclients = 0;
+  theserver.clients = malloc(opts->max_clients * sizeof(struct client));
+  // startRound cleans up first: begin with empty tables
+  memset(&theserver.board, 0, sizeof(theserver.board));
+  memset(&theserver.worms, 0, sizeof(theserver.worms));
+
+  if (theserver.clients == NULL || startRound(&theserver) != RES_OK ||
+      initializeStateBuffer(&theserver.frame, 65536) != RES_OK ||
+      initializeStateBuffer(&theserver.status, 64) != RES_OK) {
+    fprintf(stderr, "Kein Speicher fuer das Spielfeld\n");
+  } else if ((theserver.epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    perror("epoll_create1");
+  } else {
+    for (i = 0; i < opts->max_clients; i++) {
+      theserver.clients[i].fd = -1;
+    }
+    if (openListenSocket(&theserver) == RES_OK) {
+      serveClients(&theserver);
+      close(theserver.listen_fd);
+      unlink(opts->socket_path);
+      res_code = RES_OK;
+    }
+    close(theserver.epoll_fd);
+  }
+
+  cleanupStateBuffer(&theserver.frame);
+  cleanupStateBuffer(&theserver.status);
+  cleanupWormTable(&theserver.worms);
+  cleanupBoard(&theserver.board);
+  free(theserver.clients);
+  return res_code;
+}
+
+// ********************************************************************************************
+// MAIN
+// ********************************************************************************************
+
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr,
+          "Aufruf: %s [--socket PFAD] [--rate TICKS_PRO_SEKUNDE]\n"
+          "          [--clients N] [--board ZEILENxSPALTEN] [--length L]\n"
+          "          [--seed S]\n",
+          progname);
+}
+
+// Parse a number >= min; returns false if arg is not such a number
+bool parseNumber(char* arg, long min, long* result) {
+  char* end;
+  *result = strtol(arg, &end, 10);
+  return *arg != '\0' && *end == '\0' && *result >= min;
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  long value;
+  int i;
+
+  // Defaults
+  opts->socket_path = WIRE_SOCKET_PATH;
+  opts->ticks_per_second = SERVER_RATE;
+  opts->max_clients = SERVER_CLIENTS;
+  opts->nrows = SERVER_ROWS;
+  opts->ncols = SERVER_COLS;
+  opts->worm_length = WORM_LENGTH;
+  opts->seed = (uint64_t)time(NULL);
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return RES_FAILED; // All options have an argument
+    }
+    if (strcmp(argv[i], "--socket") == 0) {
+      opts->socket_path = argv[i + 1];
+    } else if (strcmp(argv[i], "--rate") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) && value <= 65535) {
+      opts->ticks_per_second = (int)value;
+    } else if (strcmp(argv[i], "--clients") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) &&
+               value <= SERVER_MAX_CLIENTS) {
+      opts->max_clients = (int)value;
+    } else if (strcmp(argv[i], "--length") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) && value <= UINT32_MAX) {
+      opts->worm_length = value;
+    } else if (strcmp(argv[i], "--seed") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->seed = (uint64_t)value;
+    } else if (strcmp(argv[i], "--board") == 0 &&
+               parseBoardSize(argv[i + 1], SERVER_MAX_CELLS, &opts->nrows,
+                              &opts->ncols) &&
+               opts->nrows <= WIRE_MAX_COORD &&
+               opts->ncols <= WIRE_MAX_COORD) {
+      // Nothing more to do
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
+  struct options opts;
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+  return runServer(&opts);
+}
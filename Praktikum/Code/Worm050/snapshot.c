@@ -0,0 +1,332 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Snapshots of a running game on disk
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "game.h"
+#include "state_buffer.h"
+#include "worm.h"
+
+static const char snapshot_magic[7] = {'W', 'O', 'R', 'M', 'S', 'N', 'P'};
+
+// Size of magic and version; the CRC covers the bytes after them
+#define SNAPSHOT_HEADER_SIZE (sizeof(snapshot_magic) + 1)
+#define SNAPSHOT_CRC_SIZE 4
+
+// CRC-32 (as in zlib) of n bytes, computed half a byte at a time
+static uint32_t crc32(const unsigned char* bytes, size_t n) {
+  static const uint32_t nibble_table[16] = {
+      0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+      0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+      0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+      0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+  uint32_t crc = 0xffffffff;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    crc ^= bytes[i];
+    crc = (crc >> 4) ^ nibble_table[crc & 0x0f];
+    crc = (crc >> 4) ^ nibble_table[crc & 0x0f];
+  }
+  return crc ^ 0xffffffff;
+}
+
+// ************************************
+// Writing
+// ************************************
+
+// Write the bytes of abuf and their CRC to a temporary file and replace
+// the snapshot by it. The old snapshot stays valid until the new one is
+// complete. The CRC is computed here, on the writer thread.
+static enum ResCodes writeSnapshotFile(const char* filename,
+                                       struct state_buffer* abuf) {
+  char tmpname[FILENAME_MAX];
+  unsigned char crc_bytes[SNAPSHOT_CRC_SIZE];
+  uint32_t crc = crc32(abuf->data + SNAPSHOT_HEADER_SIZE,
+                       abuf->size - SNAPSHOT_HEADER_SIZE);
+  FILE* file;
+  bool ok;
+  int i;
+
+  for (i = 0; i < SNAPSHOT_CRC_SIZE; i++) {
+    crc_bytes[i] = (unsigned char)(crc >> (8 * i));
+  }
+
+  if (snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename) >=
+      (int)sizeof(tmpname)) {
+    return RES_FAILED;
+  }
+  file = fopen(tmpname, "wb");
+  if (file == NULL) {
+    return RES_FAILED;
+  }
+  ok = fwrite(abuf->data, abuf->size, 1, file) == 1 &&
+       fwrite(crc_bytes, sizeof(crc_bytes), 1, file) == 1 &&
+       fflush(file) == 0 && fsync(fileno(file)) == 0;
+  if (fclose(file) != 0 || !ok || rename(tmpname, filename) != 0) {
+    remove(tmpname);
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Main loop of the writer thread: write whatever buffer is pending.
+// On shutdown a pending buffer is still written.
+static void* writerMain(void* varg) {
+  struct snapshot_writer* awriter = varg;
+
+  pthread_mutex_lock(&awriter->lock);
+  while (true) {
+    int b;
+    enum ResCodes res_code;
+
+    while (awriter->pending < 0 && !awriter->shutdown) {
+      pthread_cond_wait(&awriter->cond, &awriter->lock);
+    }
+    if (awriter->pending < 0) {
+      break; // Shut down and nothing left to do
+    }
+    b = awriter->busy = awriter->pending;
+    awriter->pending = -1;
+    pthread_mutex_unlock(&awriter->lock);
+
+    res_code = writeSnapshotFile(awriter->filename, &awriter->buffers[b]);
+
+    pthread_mutex_lock(&awriter->lock);
+    awriter->busy = -1;
+    awriter->last_result = res_code;
+    pthread_cond_broadcast(&awriter->cond);
+  }
+  pthread_mutex_unlock(&awriter->lock);
+  return NULL;
+}
+
+// Start the writer thread for snapshots of agame into filename.
+// The buffers are allocated for the current size of the game; they only
+// grow if the worms do.
+enum ResCodes initializeSnapshotWriter(struct snapshot_writer* awriter,
+                                       char* filename, struct game* agame) {
+  size_t capacity = sizeof(snapshot_magic) + 1 + 3 * 4 + 2 * 8 +
+                    savedGameSize(agame);
+
+  awriter->filename = filename;
+  awriter->pending = -1;
+  awriter->busy = -1;
+  awriter->shutdown = false;
+  awriter->last_result = RES_OK;
+  awriter->saved_tick = -1;
+  if (initializeStateBuffer(&awriter->buffers[0], capacity) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (initializeStateBuffer(&awriter->buffers[1], capacity) != RES_OK) {
+    cleanupStateBuffer(&awriter->buffers[0]);
+    return RES_FAILED;
+  }
+  pthread_mutex_init(&awriter->lock, NULL);
+  pthread_cond_init(&awriter->cond, NULL);
+  if (pthread_create(&awriter->thread, NULL, writerMain, awriter) != 0) {
+    pthread_mutex_destroy(&awriter->lock);
+    pthread_cond_destroy(&awriter->cond);
+    cleanupStateBuffer(&awriter->buffers[0]);
+    cleanupStateBuffer(&awriter->buffers[1]);
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Write the last pending snapshot and stop the thread
+void cleanupSnapshotWriter(struct snapshot_writer* awriter) {
+  pthread_mutex_lock(&awriter->lock);
+  awriter->shutdown = true;
+  pthread_cond_broadcast(&awriter->cond);
+  pthread_mutex_unlock(&awriter->lock);
+  pthread_join(awriter->thread, NULL);
+
+  pthread_mutex_destroy(&awriter->lock);
+  pthread_cond_destroy(&awriter->cond);
+  cleanupStateBuffer(&awriter->buffers[0]);
+  cleanupStateBuffer(&awriter->buffers[1]);
+}
+
+// Take a snapshot of agame. Only the serialization happens here; the
+// file is written in the background. Never waits for the disk: if the
+// previous snapshot is still being written, this one replaces a snapshot
+// still waiting for the thread.
+// Returns RES_FAILED if the previous write has failed.
+enum ResCodes saveSnapshot(struct snapshot_writer* awriter,
+                           struct game* agame) {
+  const struct game_settings* asettings = &agame->settings;
+  struct state_buffer* abuf;
+  enum ResCodes res_code;
+  int b;
+
+  // Use the buffer the thread is not working on
+  pthread_mutex_lock(&awriter->lock);
+  b = awriter->busy == 0 ? 1 : 0;
+  if (awriter->pending == b) {
+    awriter->pending = -1; // Outdated by now
+  }
+  res_code = awriter->last_result;
+  pthread_mutex_unlock(&awriter->lock);
+
+  abuf = &awriter->buffers[b];
+  clearStateBuffer(abuf);
+  putBytes(abuf, snapshot_magic, sizeof(snapshot_magic));
+  putUint8(abuf, SNAPSHOT_VERSION);
+  putUint32(abuf, asettings->nrows);
+  putUint32(abuf, asettings->ncols);
+  putUint32(abuf, asettings->nworms);
+  putUint64(abuf, (uint64_t)asettings->worm_length);
+  putUint64(abuf, asettings->seed);
+  saveGame(agame, abuf);
+  if (abuf->failed) {
+    return RES_FAILED;
+  }
+
+  pthread_mutex_lock(&awriter->lock);
+  awriter->pending = b;
+  awriter->saved_tick = agame->tick;
+  pthread_cond_broadcast(&awriter->cond);
+  pthread_mutex_unlock(&awriter->lock);
+  return res_code;
+}
+
+// Wait until all snapshots taken so far are on disk.
+// Returns the result of the last write.
+enum ResCodes waitForSnapshots(struct snapshot_writer* awriter) {
+  enum ResCodes res_code;
+
+  pthread_mutex_lock(&awriter->lock);
+  while (awriter->pending >= 0 || awriter->busy >= 0) {
+    pthread_cond_wait(&awriter->cond, &awriter->lock);
+  }
+  res_code = awriter->last_result;
+  pthread_mutex_unlock(&awriter->lock);
+  return res_code;
+}
+
+// ************************************
+// Reading
+// ************************************
+
+// Read the whole file into abuf; check magic, version and CRC.
+// Afterwards abuf ends before the CRC.
+static enum ResCodes readSnapshotFile(const char* filename,
+                                      struct state_buffer* abuf) {
+  FILE* file;
+  long size;
+  char magic[sizeof(snapshot_magic)];
+  uint32_t crc;
+
+  file = fopen(filename, "rb");
+  if (file == NULL) {
+    return RES_FAILED;
+  }
+  if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 ||
+      fseek(file, 0, SEEK_SET) != 0 ||
+      initializeStateBuffer(abuf, size) != RES_OK) {
+    fclose(file);
+    return RES_FAILED;
+  }
+  abuf->size = fread(abuf->data, 1, size, file);
+  fclose(file);
+
+  getBytes(abuf, magic, sizeof(magic));
+  if (abuf->size != (size_t)size ||
+      abuf->size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_CRC_SIZE ||
+      memcmp(magic, snapshot_magic, sizeof(magic)) != 0 ||
+      getUint8(abuf) != SNAPSHOT_VERSION) {
+    cleanupStateBuffer(abuf);
+    return RES_FAILED;
+  }
+  // A file torn by a crash is rejected before anything is read from it
+  abuf->pos = abuf->size - SNAPSHOT_CRC_SIZE;
+  crc = getUint32(abuf);
+  abuf->size -= SNAPSHOT_CRC_SIZE;
+  abuf->pos = SNAPSHOT_HEADER_SIZE;
+  if (crc != crc32(abuf->data + SNAPSHOT_HEADER_SIZE,
+                   abuf->size - SNAPSHOT_HEADER_SIZE)) {
+    cleanupStateBuffer(abuf);
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+static void readSettings(struct state_buffer* abuf,
+                         struct game_settings* asettings) {
+  asettings->nrows = (int)getUint32(abuf);
+  asettings->ncols = (int)getUint32(abuf);
+  asettings->nworms = (int)getUint32(abuf);
+  asettings->worm_length = (long)getUint64(abuf);
+  asettings->seed = getUint64(abuf);
+}
+
+// Get the settings of the game saved in filename.
+// A game set up with these settings can load the snapshot.
+enum ResCodes readSnapshotSettings(const char* filename,
+                                   struct game_settings* asettings) {
+  struct state_buffer buf;
+  enum ResCodes res_code = RES_OK;
+
+  if (readSnapshotFile(filename, &buf) != RES_OK) {
+    return RES_FAILED;
+  }
+  readSettings(&buf, asettings);
+  if (buf.failed || !isValidBoardSize(asettings->nrows, asettings->ncols,
+                                      MAX_BOARD_CELLS)) {
+    res_code = RES_FAILED;
+  }
+  cleanupStateBuffer(&buf);
+  return res_code;
+}
+
+// Continue agame from the snapshot in filename.
+// The snapshot must have been taken of a game with the same settings.
+// The snapshot is loaded into a new game first; if anything goes wrong,
+// agame is left as it is.
+enum ResCodes loadSnapshot(const char* filename, struct game* agame) {
+  const struct game_settings* current = &agame->settings;
+  struct game_settings settings;
+  struct game loaded;
+  struct state_buffer buf;
+
+  if (readSnapshotFile(filename, &buf) != RES_OK) {
+    return RES_FAILED;
+  }
+  readSettings(&buf, &settings);
+  if (buf.failed || settings.nrows != current->nrows ||
+      settings.ncols != current->ncols || settings.nworms != current->nworms ||
+      settings.worm_length != current->worm_length ||
+      settings.seed != current->seed ||
+      initializeGame(&loaded, &settings) != RES_OK) {
+    cleanupStateBuffer(&buf);
+    return RES_FAILED;
+  }
+  if (loadGame(&loaded, &buf) != RES_OK) {
+    cleanupGame(&loaded);
+    cleanupStateBuffer(&buf);
+    return RES_FAILED;
+  }
+  cleanupStateBuffer(&buf);
+
+  // Replace the running game
+  loaded.pool = agame->pool;
+  cleanupGame(agame);
+  *agame = loaded;
+  return RES_OK;
+}
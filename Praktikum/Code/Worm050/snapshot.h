@@ -0,0 +1,61 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Snapshots of a running game on disk
+//
+// The game is serialized into one of two preallocated buffers by the
+// game loop; a background thread writes the buffer to a temporary file
+// and renames it over the snapshot. Thus the game loop only pays for
+// the copy, and a crash never leaves a half written snapshot behind.
+//
+// Format (all numbers little endian):
+//   magic "WORMSNP", version byte,
+//   rows, cols, worms (u32), worm length, seed (u64),
+//   the saved game (see saveGame),
+//   CRC-32 of all bytes between the version byte and the CRC (u32)
+// A snapshot is only loaded if the CRC matches; the saved game is checked
+// again while it is loaded (see loadGame).
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include "worm.h"
+#include "game.h"
+#include "state_buffer.h"
+
+#define SNAPSHOT_VERSION 2
+
+struct snapshot_writer {
+  char* filename;                  // The snapshot file
+  pthread_t thread;                // Writes the buffers to disk
+  pthread_mutex_t lock;
+  pthread_cond_t cond;             // Signalled when pending or busy change
+  struct state_buffer buffers[2];  // Filled alternately by the game loop
+  int pending;                     // Buffer waiting for the thread; -1: none
+  int busy;                        // Buffer being written; -1: none
+  bool shutdown;                   // Tells the thread to terminate
+  enum ResCodes last_result;       // Result of the last write
+  long saved_tick;                 // Tick of the last snapshot written
+};
+
+extern enum ResCodes initializeSnapshotWriter(struct snapshot_writer* awriter,
+                                              char* filename,
+                                              struct game* agame);
+extern void cleanupSnapshotWriter(struct snapshot_writer* awriter);
+extern enum ResCodes saveSnapshot(struct snapshot_writer* awriter,
+                                  struct game* agame);
+extern enum ResCodes waitForSnapshots(struct snapshot_writer* awriter);
+
+extern enum ResCodes readSnapshotSettings(const char* filename,
+                                          struct game_settings* asettings);
+extern enum ResCodes loadSnapshot(const char* filename, struct game* agame);
+
+#endif  // #define _SNAPSHOT_H
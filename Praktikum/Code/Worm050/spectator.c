@@ -0,0 +1,231 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The spectator: watches a running game through its feed (see feed.h)
+//
+// The spectator maps the feed read-only and looks for new frames at its
+// own tick rate. It keeps a copy of the board and shows the changes like
+// the game does. If it falls behind, it takes the whole board again;
+// the game itself is never slowed down.
+
+#include <curses.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "worm.h"
+#include "board_model.h"
+#include "display.h"
+#include "feed.h"
+#include "messages.h"
+#include "prep.h"
+#include "scheduler.h"
+
+#define SPECTATOR_RATE 60 // Default number of looks at the feed per second
+
+// Settings from the command line
+struct options {
+  char* feed_name;              // Name of the shared memory object
+  int ticks_per_second;         // Looks at the feed per second
+  enum RenderBackends renderer; // How the frames get to the terminal
+};
+
+bool readUserInput();
+void showSpectatorStatus(struct feed_reader* areader, long resyncs);
+enum ResCodes doSpectator(struct options* opts, struct feed_reader* areader);
+void printUsage(char* progname);
+bool parseNumber(char* arg, long min, long* result);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
+
+// Process all keys pressed since the last call.
+// Returns true if the user wants to leave: 'q' or any key while a modal
+// dialog is open.
+bool readUserInput() {
+  int ch; // For storing the key codes
+
+  while ((ch = getch()) != ERR) {
+    if (ch == 'q' || isDialogModal()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Display the status of the user worm in the message area
+void showSpectatorStatus(struct feed_reader* areader, long resyncs) {
+  int pos_line2 = getLayout()->message_row + 2;
+  int pos_line3 = getLayout()->message_row + 3;
+  char text[80];
+
+  snprintf(text, sizeof(text),
+           "Wurm ist an Position: y=%3d x=%3d Laenge %ld Tick %ld",
+           areader->status.head_y, areader->status.head_x,
+           (long)areader->status.length, (long)areader->status.tick);
+  queueString(pos_line2, 1, text, COLP_MESSAGE);
+  snprintf(text, sizeof(text), "Zuschauer: Bild neu geholt %4ld mal",
+           resyncs);
+  queueString(pos_line3, 1, text, COLP_MESSAGE);
+}
+
+enum ResCodes doSpectator(struct options* opts, struct feed_reader* areader) {
+  struct board theboard;  // Copy of the game's board
+  struct scheduler sched; // When to look at the feed
+  enum SchedulerEvents event;
+  enum FeedEvents fevent;
+  bool end_loop = false;
+  bool closed = false;    // The game is over
+  long resyncs = 0;       // Times the whole board has been taken
+
+  if (initializeBoard(&theboard, areader->header->nrows,
+                      areader->header->ncols) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (initializeScheduler(&sched, opts->ticks_per_second) != RES_OK) {
+    cleanupBoard(&theboard);
+    return RES_FAILED;
+  }
+  setViewport(&theboard, getLayout()->board_rows, getLayout()->ncols);
+  showBorderLine();
+  showNotice("Zuschauer: q beendet");
+
+  while (!end_loop) {
+    event = waitForTickOrInput(&sched, STDIN_FILENO, false);
+    // The window may have changed its size
+    if (resizeDisplay(&theboard)) {
+      relayoutDialog(&theboard);
+      relayoutMessageArea();
+      showSpectatorStatus(areader, resyncs);
+      drawDialog();
+      flushFrame();
+      presentFrame();
+    }
+    if (event == SCHED_INTERRUPTED) {
+      continue;
+    }
+    if (event == SCHED_INPUT_READY) {
+      end_loop = readUserInput();
+      continue; // Wait for the tick
+    }
+
+    fevent = closed ? FEED_NO_FRAME : pollFeed(areader, &theboard);
+    if (fevent == FEED_FRAME || fevent == FEED_RESYNCED) {
+      // Follow the user worm like the game does
+      if (followPos(areader->status.head_y, areader->status.head_x) ||
+          fevent == FEED_RESYNCED) {
+        drawViewport(&theboard);
+      } else {
+        drawChanges(&theboard.changes);
+      }
+      clearChanges(&theboard);
+      resyncs += fevent == FEED_RESYNCED;
+    } else if (fevent == FEED_CLOSED) {
+      closed = true;
+      openDialog(&theboard, DIALOG_MODAL, "Das Spiel ist beendet",
+                 "Bitte Taste druecken");
+    }
+    drawDialog();
+    showSpectatorStatus(areader, resyncs);
+    flushFrame();
+    presentFrame();
+    finishTick(&sched);
+  }
+
+  cleanupBoard(&theboard);
+  return RES_OK;
+}
+
+// ********************************************************************************************
+// MAIN
+// ********************************************************************************************
+
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr,
+          "Aufruf: %s [--feed NAME] [--rate TICKS_PRO_SEKUNDE]\n"
+          "          [--renderer curses|ansi]\n",
+          progname);
+}
+
+// Parse a number >= min; returns false if arg is not such a number
+bool parseNumber(char* arg, long min, long* result) {
+  char* end;
+  *result = strtol(arg, &end, 10);
+  return *arg != '\0' && *end == '\0' && *result >= min;
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  long value;
+  int i;
+
+  // Defaults
+  opts->feed_name = FEED_NAME;
+  opts->ticks_per_second = SPECTATOR_RATE;
+  opts->renderer = RENDER_CURSES;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return RES_FAILED; // All options have an argument
+    }
+    if (strcmp(argv[i], "--feed") == 0) {
+      opts->feed_name = argv[i + 1];
+    } else if (strcmp(argv[i], "--rate") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->ticks_per_second = (int)value;
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "curses") == 0) {
+      opts->renderer = RENDER_CURSES;
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "ansi") == 0) {
+      opts->renderer = RENDER_ANSI;
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
+  enum ResCodes res_code;    // Result code from functions
+  struct options opts;       // Settings from the command line
+  struct feed_reader reader; // The mapped feed
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+  if (openFeed(&reader, opts.feed_name) != RES_OK) {
+    fprintf(stderr, "Kein laufendes Spiel mit dem Feed %s\n", opts.feed_name);
+    return RES_FAILED;
+  }
+
+  // Here we start
+  initializeCursesApplication(); // Init various settings of our application
+  if (LINES < ROWS_RESERVED + MIN_NUMBER_OF_ROWS ||
+      COLS < MIN_NUMBER_OF_COLS) {
+    cleanupCursesApp();
+    printf("Das Fenster ist zu klein: wir brauchen mindestens %dx%d\n",
+           MIN_NUMBER_OF_COLS, MIN_NUMBER_OF_ROWS + ROWS_RESERVED);
+    res_code = RES_FAILED;
+  } else if (initializeDisplay(opts.renderer) != RES_OK) {
+    cleanupCursesApp();
+    res_code = RES_FAILED;
+  } else {
+    res_code = doSpectator(&opts, &reader);
+    cleanupDisplay();
+    cleanupCursesApp();
+  }
+  closeFeed(&reader);
+  return res_code;
+}
@@ -0,0 +1,176 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A byte buffer for saving and loading the state of a game
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "state_buffer.h"
+#include "worm.h"
+
+// An empty buffer for writing; it grows if capacity is exceeded
+enum ResCodes initializeStateBuffer(struct state_buffer* abuf,
+                                    size_t capacity) {
+  if (capacity < 64) {
+    capacity = 64;
+  }
+  abuf->data = malloc(capacity);
+  if (abuf->data == NULL) {
+    abuf->capacity = 0;
+    return RES_FAILED;
+  }
+  abuf->capacity = capacity;
+  clearStateBuffer(abuf);
+  return RES_OK;
+}
+
+void cleanupStateBuffer(struct state_buffer* abuf) {
+  if (abuf->capacity > 0) {
+    free(abuf->data);
+  }
+  abuf->data = NULL;
+  abuf->capacity = 0;
+  abuf->size = 0;
+}
+
+// Read size bytes at data, e.g. from a mapped file. The bytes are not copied.
+void viewStateBuffer(struct state_buffer* abuf, const unsigned char* data,
+                     size_t size) {
+  abuf->data = (unsigned char*)data;
+  abuf->size = size;
+  abuf->capacity = 0;
+  abuf->pos = 0;
+  abuf->failed = false;
+}
+
+// Start writing from the beginning again; the memory is kept
+void clearStateBuffer(struct state_buffer* abuf) {
+  abuf->size = 0;
+  abuf->pos = 0;
+  abuf->failed = false;
+}
+
+// Make room for n more bytes. Returns a pointer to them or NULL.
+static unsigned char* reserve(struct state_buffer* abuf, size_t n) {
+  unsigned char* p;
+
+  if (abuf->failed) {
+    return NULL;
+  }
+  if (abuf->size + n > abuf->capacity) {
+    size_t capacity = abuf->capacity;
+    unsigned char* data;
+
+    if (capacity == 0) {
+      abuf->failed = true; // Not our memory
+      return NULL;
+    }
+    while (abuf->size + n > capacity) {
+      capacity *= 2;
+    }
+    data = realloc(abuf->data, capacity);
+    if (data == NULL) {
+      abuf->failed = true;
+      return NULL;
+    }
+    abuf->data = data;
+    abuf->capacity = capacity;
+  }
+  p = abuf->data + abuf->size;
+  abuf->size += n;
+  return p;
+}
+
+// Take n bytes from the buffer. Returns a pointer to them or NULL.
+static const unsigned char* consume(struct state_buffer* abuf, size_t n) {
+  const unsigned char* p;
+
+  if (abuf->failed || n > abuf->size - abuf->pos) {
+    abuf->failed = true;
+    return NULL;
+  }
+  p = abuf->data + abuf->pos;
+  abuf->pos += n;
+  return p;
+}
+
+static void putLittleEndian(struct state_buffer* abuf, uint64_t value,
+                            int nbytes) {
+  unsigned char* p = reserve(abuf, nbytes);
+  int i;
+
+  if (p != NULL) {
+    for (i = 0; i < nbytes; i++) {
+      p[i] = (unsigned char)(value >> (8 * i));
+    }
+  }
+}
+
+static uint64_t getLittleEndian(struct state_buffer* abuf, int nbytes) {
+  const unsigned char* p = consume(abuf, nbytes);
+  uint64_t value = 0;
+  int i;
+
+  if (p != NULL) {
+    for (i = 0; i < nbytes; i++) {
+      value |= (uint64_t)p[i] << (8 * i);
+    }
+  }
+  return value;
+}
+
+void putUint8(struct state_buffer* abuf, uint8_t value) {
+  putLittleEndian(abuf, value, 1);
+}
+
+void putUint16(struct state_buffer* abuf, uint16_t value) {
+  putLittleEndian(abuf, value, 2);
+}
+
+void putUint32(struct state_buffer* abuf, uint32_t value) {
+  putLittleEndian(abuf, value, 4);
+}
+
+void putUint64(struct state_buffer* abuf, uint64_t value) {
+  putLittleEndian(abuf, value, 8);
+}
+
+void putBytes(struct state_buffer* abuf, const void* bytes, size_t n) {
+  unsigned char* p = reserve(abuf, n);
+  if (p != NULL) {
+    memcpy(p, bytes, n);
+  }
+}
+
+uint8_t getUint8(struct state_buffer* abuf) {
+  return (uint8_t)getLittleEndian(abuf, 1);
+}
+
+uint16_t getUint16(struct state_buffer* abuf) {
+  return (uint16_t)getLittleEndian(abuf, 2);
+}
+
+uint32_t getUint32(struct state_buffer* abuf) {
+  return (uint32_t)getLittleEndian(abuf, 4);
+}
+
+uint64_t getUint64(struct state_buffer* abuf) {
+  return getLittleEndian(abuf, 8);
+}
+
+void getBytes(struct state_buffer* abuf, void* bytes, size_t n) {
+  const unsigned char* p = consume(abuf, n);
+  if (p != NULL) {
+    memcpy(bytes, p, n);
+  } else {
+    memset(bytes, 0, n);
+  }
+}
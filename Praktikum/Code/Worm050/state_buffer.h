@@ -0,0 +1,52 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A byte buffer for saving and loading the state of a game.
+//
+// Numbers are stored in little endian byte order regardless of the
+// machine. Errors are sticky: after a write that could not grow the
+// buffer or a read past its end, the flag failed stays set and all
+// further reads return 0. Thus callers check once at the end.
+
+#ifndef _STATE_BUFFER_H
+#define _STATE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "worm.h"
+
+struct state_buffer {
+  unsigned char* data; // The bytes
+  size_t size;         // Number of bytes written or available for reading
+  size_t capacity;     // Number of allocated bytes; 0: data is not ours
+  size_t pos;          // Position of the next read
+  bool failed;         // A write or read went wrong
+};
+
+extern enum ResCodes initializeStateBuffer(struct state_buffer* abuf,
+                                           size_t capacity);
+extern void cleanupStateBuffer(struct state_buffer* abuf);
+extern void viewStateBuffer(struct state_buffer* abuf,
+                            const unsigned char* data, size_t size);
+extern void clearStateBuffer(struct state_buffer* abuf);
+
+extern void putUint8(struct state_buffer* abuf, uint8_t value);
+extern void putUint16(struct state_buffer* abuf, uint16_t value);
+extern void putUint32(struct state_buffer* abuf, uint32_t value);
+extern void putUint64(struct state_buffer* abuf, uint64_t value);
+extern void putBytes(struct state_buffer* abuf, const void* bytes, size_t n);
+
+extern uint8_t getUint8(struct state_buffer* abuf);
+extern uint16_t getUint16(struct state_buffer* abuf);
+extern uint32_t getUint32(struct state_buffer* abuf);
+extern uint64_t getUint64(struct state_buffer* abuf);
+extern void getBytes(struct state_buffer* abuf, void* bytes, size_t n);
+
+#endif  // #define _STATE_BUFFER_H
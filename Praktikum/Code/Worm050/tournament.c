@@ -0,0 +1,407 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The tournament: many headless games at once
+//
+// Every game has its own seed, its own state and its own controller for
+// the user worm. Each thread starts with an equal share of the games;
+// a thread that runs out of games steals half of the remaining games of
+// another thread. The statistics do not depend on the number of threads.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "worm.h"
+#include "autopilot.h"
+#include "game.h"
+#include "worker_pool.h"
+
+// Defaults of the tournament
+#define TOURNAMENT_GAMES 1000
+#define TOURNAMENT_ROWS 24
+#define TOURNAMENT_COLS 80
+#define TOURNAMENT_MAX_TICKS 100000 // A game surviving so long is stopped
+
+#define NUMBER_OF_GAME_STATES (WORM_OUT_OF_MEMORY + 1)
+
+// Who steers the user worm
+enum Controllers {
+  CONTROL_BOT,       // Like a bot worm (see steerBot)
+  CONTROL_BORDER,    // Along the border of the board
+  CONTROL_AUTOPILOT, // Shortest paths and tail chasing (see autopilot.c)
+};
+
+static const char* controller_names[] = {"bot", "border", "autopilot"};
+
+// Settings from the command line
+struct options {
+  long ngames;      // Number of games
+  int nthreads;     // Number of threads
+  long max_ticks;   // Maximal length of a game
+  enum Controllers controller;
+  struct game_settings game; // The seed of game i is game.seed + i
+};
+
+// Results of a number of games
+struct tournament_stats {
+  long games;          // Number of games played
+  long failed;         // Number of games that could not be set up
+  long total_ticks;    // Sum of the survival ticks of all games
+  long max_ticks;      // Longest survival
+  long ends[NUMBER_OF_GAME_STATES]; // Number of games per final state
+  uint64_t checksum;   // Sum of the fingerprints of all final states
+};
+
+// The games still to be played by a thread: next..end-1
+struct game_range {
+  pthread_mutex_t lock;
+  long next;
+  long end;
+};
+
+// Everything a thread needs; nothing is shared except the ranges
+struct tournament_worker {
+  struct tournament* atour;
+  struct game_range range;
+  struct tournament_stats stats;
+  struct autopilot pilot; // Used by CONTROL_AUTOPILOT
+  bool has_pilot;
+  long steals;            // Number of successful steals
+};
+
+struct tournament {
+  struct options* opts;
+  int nworkers;
+  struct tournament_worker workers[MAX_WORKER_THREADS];
+};
+
+void clearStats(struct tournament_stats* astats);
+void addStats(struct tournament_stats* asum,
+              const struct tournament_stats* astats);
+enum ResCodes playGame(struct tournament_worker* aworker, long index);
+bool takeGame(struct tournament_worker* aworker, long* aindex);
+void runWorker(void* arg, int begin, int end);
+enum ResCodes runTournament(struct options* opts);
+void printUsage(char* progname);
+bool parseNumber(char* arg, long min, long* result);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
+
+// ************************************
+// Statistics
+// ************************************
+
+void clearStats(struct tournament_stats* astats) {
+  memset(astats, 0, sizeof(*astats));
+}
+
+// Add the results in astats to asum; the order does not matter
+void addStats(struct tournament_stats* asum,
+              const struct tournament_stats* astats) {
+  int i;
+
+  asum->games += astats->games;
+  asum->failed += astats->failed;
+  asum->total_ticks += astats->total_ticks;
+  if (astats->max_ticks > asum->max_ticks) {
+    asum->max_ticks = astats->max_ticks;
+  }
+  for (i = 0; i < NUMBER_OF_GAME_STATES; i++) {
+    asum->ends[i] += astats->ends[i];
+  }
+  asum->checksum += astats->checksum;
+}
+
+// ************************************
+// Playing
+// ************************************
+
+// Play game number index to its end and add the result to the
+// statistics of aworker
+enum ResCodes playGame(struct tournament_worker* aworker, long index) {
+  struct options* opts = aworker->atour->opts;
+  struct game_settings settings = opts->game;
+  struct game thegame;
+
+  settings.seed = opts->game.seed + (uint64_t)index;
+  if (initializeGame(&thegame, &settings) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (opts->controller == CONTROL_AUTOPILOT) {
+    // All games have the same board: the search arrays are reused
+    if (!aworker->has_pilot) {
+      initializeAutopilot(&aworker->pilot, &thegame);
+      if (prepareAutopilot(&aworker->pilot) != RES_OK) {
+        cleanupGame(&thegame);
+        return RES_FAILED;
+      }
+      aworker->has_pilot = true;
+    }
+    resetAutopilot(&aworker->pilot, &thegame);
+  }
+
+  while (thegame.game_state == WORM_GAME_ONGOING &&
+         thegame.tick < opts->max_ticks) {
+    switch (opts->controller) {
+    case CONTROL_BOT:
+      steerBot(&thegame, USER_WORM_ID);
+      break;
+    case CONTROL_BORDER:
+      steerAlongBorder(&thegame);
+      break;
+    case CONTROL_AUTOPILOT:
+      steerAutopilot(&aworker->pilot, &thegame);
+      break;
+    }
+    stepGame(&thegame);
+  }
+
+  aworker->stats.games++;
+  aworker->stats.total_ticks += thegame.tick;
+  if (thegame.tick > aworker->stats.max_ticks) {
+    aworker->stats.max_ticks = thegame.tick;
+  }
+  aworker->stats.ends[thegame.game_state]++;
+  aworker->stats.checksum += hashGame(&thegame);
+  cleanupGame(&thegame);
+  return RES_OK;
+}
+
+// Get the number of the next game for aworker.
+// Own games are taken from the front. If there are none left, the back
+// half of the games of another worker is stolen.
+// Returns false if all games are taken.
+bool takeGame(struct tournament_worker* aworker, long* aindex) {
+  struct tournament* atour = aworker->atour;
+  int self = aworker - atour->workers;
+  int i;
+
+  pthread_mutex_lock(&aworker->range.lock);
+  if (aworker->range.next < aworker->range.end) {
+    *aindex = aworker->range.next++;
+    pthread_mutex_unlock(&aworker->range.lock);
+    return true;
+  }
+  pthread_mutex_unlock(&aworker->range.lock);
+
+  // Ranges only shrink; if all are empty, we are done
+  for (i = 1; i < atour->nworkers; i++) {
+    struct game_range* victim =
+        &atour->workers[(self + i) % atour->nworkers].range;
+    long begin, end;
+
+    pthread_mutex_lock(&victim->lock);
+    end = victim->end;
+    begin = victim->next + (victim->end - victim->next) / 2;
+    victim->end = begin;
+    pthread_mutex_unlock(&victim->lock);
+    if (begin == end) {
+      continue;
+    }
+    // Play the first stolen game now and keep the rest
+    pthread_mutex_lock(&aworker->range.lock);
+    aworker->range.next = begin + 1;
+    aworker->range.end = end;
+    pthread_mutex_unlock(&aworker->range.lock);
+    aworker->steals++;
+    *aindex = begin;
+    return true;
+  }
+  return false;
+}
+
+// The task of thread number begin in the worker pool (end == begin + 1)
+void runWorker(void* arg, int begin, int end) {
+  struct tournament* atour = arg;
+  struct tournament_worker* aworker = &atour->workers[begin];
+  long index;
+
+  while (takeGame(aworker, &index)) {
+    if (playGame(aworker, index) != RES_OK) {
+      // Not a played game: kept out of the ends and their percentages
+      aworker->stats.failed++;
+    }
+  }
+}
+
+// Play all games and print the statistics
+enum ResCodes runTournament(struct options* opts) {
+  static struct tournament thetour; // Too large for the stack
+  struct tournament_stats total;
+  struct worker_pool pool;
+  struct timespec start, stop;
+  double seconds;
+  long steals = 0;
+  int i;
+
+  if (initializeWorkerPool(&pool, opts->nthreads) != RES_OK) {
+    return RES_FAILED;
+  }
+  thetour.opts = opts;
+  thetour.nworkers = opts->nthreads;
+  for (i = 0; i < thetour.nworkers; i++) {
+    struct tournament_worker* aworker = &thetour.workers[i];
+    aworker->atour = &thetour;
+    pthread_mutex_init(&aworker->range.lock, NULL);
+    // An equal share of the games for each thread
+    aworker->range.next = opts->ngames * i / thetour.nworkers;
+    aworker->range.end = opts->ngames * (i + 1) / thetour.nworkers;
+    clearStats(&aworker->stats);
+    aworker->has_pilot = false;
+    aworker->steals = 0;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  runOnWorkers(&pool, runWorker, &thetour, thetour.nworkers);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  cleanupWorkerPool(&pool);
+
+  clearStats(&total);
+  for (i = 0; i < thetour.nworkers; i++) {
+    struct tournament_worker* aworker = &thetour.workers[i];
+    addStats(&total, &aworker->stats);
+    steals += aworker->steals;
+    if (aworker->has_pilot) {
+      cleanupAutopilot(&aworker->pilot);
+    }
+    pthread_mutex_destroy(&aworker->range.lock);
+  }
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  printf("Spiele: %ld  Threads: %d  Steuerung: %s  Spielfeld: %dx%d"
+         "  Wuermer: %d\n",
+         total.games, opts->nthreads, controller_names[opts->controller],
+         opts->game.nrows, opts->game.ncols, opts->game.nworms);
+  printf("Ueberlebte Ticks: Mittel: %.1f  Max: %ld  (Grenze: %ld)\n",
+         total.games > 0 ? (double)total.total_ticks / total.games : 0.0,
+         total.max_ticks, opts->max_ticks);
+  printf("Spielende:\n");
+  for (i = 0; i < NUMBER_OF_GAME_STATES; i++) {
+    if (total.ends[i] > 0) {
+      printf("  %-20s %10ld  %5.1f%%\n", gameStateName(i), total.ends[i],
+             100.0 * total.ends[i] / total.games);
+    }
+  }
+  if (total.failed > 0) {
+    printf("Nicht gestartet (kein Speicher): %ld\n", total.failed);
+  }
+  printf("Zeit: %.3f s  Spiele/s: %.1f  Ticks/s: %.0f  Diebstaehle: %ld\n",
+         seconds, seconds > 0 ? total.games / seconds : 0.0,
+         seconds > 0 ? total.total_ticks / seconds : 0.0, steals);
+  // Runs with the same options must end with the same checksum
+  printf("Pruefsumme: %016llx\n", (unsigned long long)total.checksum);
+  return total.games == opts->ngames ? RES_OK : RES_FAILED;
+}
+
+// ********************************************************************************************
+// MAIN
+// ********************************************************************************************
+
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr,
+          "Aufruf: %s [--games N] [--threads N] [--seed S]\n"
+          "          [--controller bot|border|autopilot] [--max-ticks M]\n"
+          "          [--board ZEILENxSPALTEN] [--worms N] [--length L]\n",
+          progname);
+}
+
+// Parse a number >= min; returns false if arg is not such a number
+bool parseNumber(char* arg, long min, long* result) {
+  char* end;
+  *result = strtol(arg, &end, 10);
+  return *arg != '\0' && *end == '\0' && *result >= min;
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  long value;
+  int i, c;
+
+  // Defaults
+  opts->ngames = TOURNAMENT_GAMES;
+  opts->nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (opts->nthreads < 1) {
+    opts->nthreads = 1;
+  } else if (opts->nthreads > MAX_WORKER_THREADS) {
+    opts->nthreads = MAX_WORKER_THREADS;
+  }
+  opts->max_ticks = TOURNAMENT_MAX_TICKS;
+  opts->controller = CONTROL_AUTOPILOT;
+  defaultGameSettings(&opts->game);
+  opts->game.nrows = TOURNAMENT_ROWS;
+  opts->game.ncols = TOURNAMENT_COLS;
+  opts->game.seed = 1;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 == argc) {
+      return RES_FAILED; // All options have an argument
+    }
+    if (strcmp(argv[i], "--games") == 0 &&
+        parseNumber(argv[i + 1], 1, &value)) {
+      opts->ngames = value;
+    } else if (strcmp(argv[i], "--threads") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) &&
+               value <= MAX_WORKER_THREADS) {
+      opts->nthreads = (int)value;
+    } else if (strcmp(argv[i], "--seed") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->game.seed = (uint64_t)value;
+    } else if (strcmp(argv[i], "--max-ticks") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->max_ticks = value;
+    } else if (strcmp(argv[i], "--worms") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) && value <= MAX_WORMS) {
+      opts->game.nworms = (int)value;
+    } else if (strcmp(argv[i], "--length") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->game.worm_length = value;
+    } else if (strcmp(argv[i], "--board") == 0 &&
+               parseBoardSize(argv[i + 1], MAX_BOARD_CELLS, &opts->game.nrows,
+                              &opts->game.ncols)) {
+      // Nothing more to do
+    } else if (strcmp(argv[i], "--controller") == 0) {
+      for (c = CONTROL_BOT; c <= CONTROL_AUTOPILOT; c++) {
+        if (strcmp(argv[i + 1], controller_names[c]) == 0) {
+          break;
+        }
+      }
+      if (c > CONTROL_AUTOPILOT) {
+        fprintf(stderr, "Unbekannte Steuerung: %s\n", argv[i + 1]);
+        return RES_FAILED;
+      }
+      opts->controller = (enum Controllers)c;
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  // Every thread starts with at least one game
+  if (opts->nthreads > opts->ngames) {
+    opts->nthreads = (int)opts->ngames;
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
+  struct options opts; // Settings from the command line
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+  return runTournament(&opts);
+}
@@ -0,0 +1,143 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Tracing the phases of the game loop into a Chrome trace file
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+#include "profiler.h"
+#include "worm.h"
+
+#define NSEC_PER_SEC 1000000000L
+
+// Names of the phases in the trace: the functions doing the work
+static const char* phase_names[NUMBER_OF_PHASES] = {
+    "readUserInput", "stepGameTails", "stepGameMoves",
+    "drawChanges",   "presentFrame",  "waitForTickOrInput"};
+
+// Write all events from the ring into the file; returns the number
+static long writeEvents(struct tracer* atracer) {
+  // The events before head are complete
+  unsigned long head = __atomic_load_n(&atracer->head, __ATOMIC_ACQUIRE);
+  unsigned long tail = atracer->tail;
+  long count = 0;
+
+  for (; tail != head; tail++, count++) {
+    struct trace_event* aevent =
+        &atracer->events[tail & (TRACE_CAPACITY - 1)];
+
+    fprintf(atracer->file,
+            ",\n{\"name\":\"%s\",\"cat\":\"tick\",\"ph\":\"X\","
+            "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"tick\":%ld}}",
+            phase_names[aevent->phase],
+            (aevent->start_ns - atracer->origin_ns) / 1e3,
+            aevent->dur_ns / 1e3, aevent->tick);
+  }
+  // Hand the slots back to the game loop
+  __atomic_store_n(&atracer->tail, tail, __ATOMIC_RELEASE);
+  return count;
+}
+
+// Main loop of the flush thread: empty the ring now and then
+static void* flushMain(void* varg) {
+  struct tracer* atracer = varg;
+  struct timespec pause = {0, TRACE_FLUSH_NS};
+
+  while (!__atomic_load_n(&atracer->shutdown, __ATOMIC_ACQUIRE)) {
+    if (writeEvents(atracer) > 0) {
+      fflush(atracer->file);
+    }
+    nanosleep(&pause, NULL);
+  }
+  writeEvents(atracer);
+  return NULL;
+}
+
+// Open filename for the trace and start the flush thread
+enum ResCodes startTracing(struct tracer* atracer, char* filename) {
+  struct timespec now;
+
+  atracer->events = malloc(TRACE_CAPACITY * sizeof(struct trace_event));
+  if (atracer->events == NULL) {
+    return RES_FAILED;
+  }
+  atracer->file = fopen(filename, "w");
+  if (atracer->file == NULL) {
+    free(atracer->events);
+    return RES_FAILED;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  atracer->origin_ns = (long long)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+  atracer->head = 0;
+  atracer->tail = 0;
+  atracer->shutdown = false;
+  atracer->dropped = 0;
+
+  // Every event starts with a comma; the name of the thread comes first
+  fprintf(atracer->file,
+          "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+          "\"args\":{\"name\":\"doLevel\"}}");
+  if (pthread_create(&atracer->thread, NULL, flushMain, atracer) != 0) {
+    fclose(atracer->file);
+    free(atracer->events);
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+// Put the phase from start_ns to end_ns of the tick into the ring.
+// Called by the game loop only; never blocks.
+void traceEvent(struct tracer* atracer, int phase, long long start_ns,
+                long long end_ns, long tick) {
+  unsigned long head = atracer->head;
+  struct trace_event* aevent;
+
+  if (head - __atomic_load_n(&atracer->tail, __ATOMIC_ACQUIRE) ==
+      TRACE_CAPACITY) {
+    atracer->dropped++; // The thread is behind: lose the event
+    return;
+  }
+  aevent = &atracer->events[head & (TRACE_CAPACITY - 1)];
+  aevent->start_ns = start_ns;
+  aevent->dur_ns = (long)(end_ns - start_ns);
+  aevent->tick = tick;
+  aevent->phase = phase;
+  // Publish the event to the thread
+  __atomic_store_n(&atracer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Write the remaining events, close the file and stop the thread.
+// Returns RES_FAILED if the file could not be written completely.
+enum ResCodes stopTracing(struct tracer* atracer) {
+  bool ok;
+
+  __atomic_store_n(&atracer->shutdown, true, __ATOMIC_RELEASE);
+  pthread_join(atracer->thread, NULL);
+
+  if (atracer->dropped > 0) {
+    fprintf(atracer->file,
+            ",\n{\"name\":\"dropped\",\"ph\":\"i\",\"s\":\"g\",\"ts\":0,"
+            "\"pid\":1,\"tid\":1,\"args\":{\"events\":%ld}}",
+            atracer->dropped);
+  }
+  fprintf(atracer->file, "\n]}\n");
+  ok = !ferror(atracer->file);
+  if (fclose(atracer->file) != 0) {
+    ok = false;
+  }
+  free(atracer->events);
+  return ok ? RES_OK : RES_FAILED;
+}
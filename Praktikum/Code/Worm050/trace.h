@@ -0,0 +1,56 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// Tracing the phases of the game loop into a Chrome trace file
+//
+// The file is in the JSON trace event format; it can be opened with
+// chrome://tracing or https://ui.perfetto.dev. Each phase of a tick
+// becomes a complete event ("ph":"X") with the tick number as argument.
+//
+// The game loop only puts the events into a ring in memory. The ring has
+// one writer (the game loop) and one reader (the flush thread), so the
+// two threads need no lock: each advances its own index, and the other
+// one sees it with acquire/release ordering. The game loop never waits;
+// if the ring is full, the event is dropped and counted.
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "worm.h"
+
+#define TRACE_CAPACITY 65536     // Events in the ring; a power of two
+#define TRACE_FLUSH_NS 50000000L // The flush thread looks so often
+
+struct trace_event {
+  long long start_ns; // Begin of the phase on CLOCK_MONOTONIC
+  long dur_ns;        // Length of the phase
+  long tick;          // Number of the tick
+  int phase;          // enum ProfilePhases
+};
+
+struct tracer {
+  FILE* file;
+  pthread_t thread;           // Writes the events into the file
+  struct trace_event* events; // The ring
+  unsigned long head;         // Next slot to fill; only the game loop writes
+  unsigned long tail;         // Next event to write; only the thread writes
+  bool shutdown;              // Tells the thread to write the rest and stop
+  long dropped;               // Events lost because the ring was full
+  long long origin_ns;        // Time 0 of the trace
+};
+
+extern enum ResCodes startTracing(struct tracer* atracer, char* filename);
+extern void traceEvent(struct tracer* atracer, int phase, long long start_ns,
+                       long long end_ns, long tick);
+extern enum ResCodes stopTracing(struct tracer* atracer);
+
+#endif  // #define _TRACE_H
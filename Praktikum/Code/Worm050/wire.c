@@ -0,0 +1,114 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The wire format between worm-server and worm-client
+
+#include <curses.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wire.h"
+#include "board_model.h"
+#include "state_buffer.h"
+#include "worm.h"
+
+void putWireHeader(struct state_buffer* abuf, enum WireTypes type, int arg,
+                   int count, long tick) {
+  putUint8(abuf, (uint8_t)type);
+  putUint8(abuf, (uint8_t)arg);
+  putUint16(abuf, (uint16_t)count);
+  putUint32(abuf, (uint32_t)tick);
+}
+
+// Append count cells; more than WIRE_MAX_CELLS go into several messages
+void putWireCells(struct state_buffer* abuf, const struct cell_change* cells,
+                  int count, long tick) {
+  while (count > 0) {
+    int n = count < WIRE_MAX_CELLS ? count : WIRE_MAX_CELLS;
+    int i;
+
+    putWireHeader(abuf, WIRE_CELLS, 0, n, tick);
+    for (i = 0; i < n; i++) {
+      putUint16(abuf, (uint16_t)cells[i].y);
+      putUint16(abuf, (uint16_t)cells[i].x);
+      putUint8(abuf, (uint8_t)(cells[i].symbol & A_CHARTEXT));
+      putUint8(abuf, (uint8_t)cells[i].color_pair);
+    }
+    cells += n;
+    count -= n;
+  }
+}
+
+void putWireWelcome(struct state_buffer* abuf,
+                    const struct wire_welcome* awelcome, long tick) {
+  putWireHeader(abuf, WIRE_WELCOME, 0, 0, tick);
+  putUint16(abuf, (uint16_t)awelcome->nrows);
+  putUint16(abuf, (uint16_t)awelcome->ncols);
+  putUint16(abuf, (uint16_t)awelcome->id);
+  putUint16(abuf, (uint16_t)awelcome->ticks_per_second);
+}
+
+void putWireStatus(struct state_buffer* abuf,
+                   const struct wire_status* astatus, long tick) {
+  putWireHeader(abuf, WIRE_STATUS, astatus->state, 0, tick);
+  putUint16(abuf, (uint16_t)astatus->headpos.y);
+  putUint16(abuf, (uint16_t)astatus->headpos.x);
+  putUint32(abuf, (uint32_t)astatus->length);
+}
+
+// Size of the message at the start of data (size bytes received so far).
+// Returns 0 if the header is not complete yet and -1 for an unknown type.
+// The body may still be incomplete: compare the result with size.
+long wireMessageSize(const unsigned char* data, size_t size) {
+  if (size < WIRE_HEADER_SIZE) {
+    return 0;
+  }
+  switch (data[0]) {
+  case WIRE_HEADING:
+  case WIRE_REJECT:
+    return WIRE_HEADER_SIZE;
+  case WIRE_WELCOME:
+  case WIRE_STATUS:
+    return WIRE_HEADER_SIZE + WIRE_BODY_SIZE;
+  case WIRE_CELLS:
+    // The count is little endian at offset 2
+    return WIRE_HEADER_SIZE +
+           (long)(data[2] | data[3] << 8) * WIRE_CELL_SIZE;
+  }
+  return -1;
+}
+
+void getWireHeader(struct state_buffer* abuf, struct wire_header* aheader) {
+  aheader->type = (enum WireTypes)getUint8(abuf);
+  aheader->arg = getUint8(abuf);
+  aheader->count = getUint16(abuf);
+  aheader->tick = getUint32(abuf);
+}
+
+void getWireCell(struct state_buffer* abuf, struct cell_change* acell) {
+  acell->y = getUint16(abuf);
+  acell->x = getUint16(abuf);
+  acell->symbol = getUint8(abuf);
+  acell->color_pair = (enum ColorPairs)getUint8(abuf);
+}
+
+void getWireWelcome(struct state_buffer* abuf,
+                    struct wire_welcome* awelcome) {
+  awelcome->nrows = getUint16(abuf);
+  awelcome->ncols = getUint16(abuf);
+  awelcome->id = getUint16(abuf);
+  awelcome->ticks_per_second = getUint16(abuf);
+}
+
+// The state of the worm is the arg of the header read before
+void getWireStatus(struct state_buffer* abuf, struct wire_status* astatus) {
+  astatus->headpos.y = getUint16(abuf);
+  astatus->headpos.x = getUint16(abuf);
+  astatus->length = getUint32(abuf);
+}
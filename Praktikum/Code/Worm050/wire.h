@@ -0,0 +1,91 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// The wire format between worm-server and worm-client
+//
+// Server and clients talk over a UNIX domain socket. Every message starts
+// with a header of WIRE_HEADER_SIZE bytes:
+//
+//   type (1), arg (1), count (2), tick (4)
+//
+// followed by a body whose size depends on the type only (and on count
+// for WIRE_CELLS). All numbers are little endian (see state_buffer.h).
+//
+// A client only sends WIRE_HEADING. The server sends WIRE_WELCOME and the
+// whole board once, then per tick the changed cells and the status of the
+// client's worm. WIRE_STATUS ends a tick: the client renders then.
+
+#ifndef _WIRE_H
+#define _WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "worm.h"
+#include "board_model.h"
+#include "state_buffer.h"
+
+#define WIRE_SOCKET_PATH "/tmp/worm-server.sock" // Default socket
+
+#define WIRE_HEADER_SIZE 8
+#define WIRE_CELL_SIZE 6    // y (2), x (2), symbol (1), color pair (1)
+#define WIRE_BODY_SIZE 8    // Body of WIRE_WELCOME and WIRE_STATUS
+#define WIRE_MAX_CELLS 65535 // Cells per WIRE_CELLS message
+#define WIRE_MAX_COORD 65535 // Largest row or column on the wire
+
+enum WireTypes {
+  WIRE_HEADING = 1, // Client: arg is the new heading; no body
+  WIRE_WELCOME,     // Server: rows, cols, worm id, ticks per second
+  WIRE_CELLS,       // Server: count cells follow
+  WIRE_STATUS,      // Server: end of a tick; arg is the worm's state;
+                    // head y, head x, length
+  WIRE_REJECT,      // Server: no room for another worm; no body
+};
+
+struct wire_header {
+  enum WireTypes type;
+  int arg;
+  int count;
+  long tick;
+};
+
+// Body of WIRE_WELCOME
+struct wire_welcome {
+  int nrows;            // Size of the board
+  int ncols;
+  int id;               // Id of the client's worm
+  int ticks_per_second; // Tick rate of the server
+};
+
+// Body of WIRE_STATUS
+struct wire_status {
+  enum GameStates state; // State of the client's worm
+  struct pos headpos;
+  long length;
+};
+
+extern void putWireHeader(struct state_buffer* abuf, enum WireTypes type,
+                          int arg, int count, long tick);
+extern void putWireCells(struct state_buffer* abuf,
+                         const struct cell_change* cells, int count,
+                         long tick);
+extern void putWireWelcome(struct state_buffer* abuf,
+                           const struct wire_welcome* awelcome, long tick);
+extern void putWireStatus(struct state_buffer* abuf,
+                          const struct wire_status* astatus, long tick);
+
+extern long wireMessageSize(const unsigned char* data, size_t size);
+extern void getWireHeader(struct state_buffer* abuf,
+                          struct wire_header* aheader);
+extern void getWireCell(struct state_buffer* abuf, struct cell_change* acell);
+extern void getWireWelcome(struct state_buffer* abuf,
+                           struct wire_welcome* awelcome);
+extern void getWireStatus(struct state_buffer* abuf,
+                          struct wire_status* astatus);
+
+#endif  // #define _WIRE_H
@@ -0,0 +1,123 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A pool of worker threads for data parallel loops
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "worker_pool.h"
+#include "worm.h"
+
+// Process slice index of the current job
+static void runSlice(struct worker_pool* apool, int index) {
+  int begin = (int)((long)apool->nitems * index / apool->nthreads);
+  int end = (int)((long)apool->nitems * (index + 1) / apool->nthreads);
+  if (begin < end) {
+    apool->task(apool->arg, begin, end);
+  }
+}
+
+// Main loop of a worker thread: wait for a job, do our slice, report
+static void* workerMain(void* varg) {
+  struct worker_arg* warg = varg;
+  struct worker_pool* apool = warg->pool;
+  long seen = 0; // Last generation we have worked on
+
+  pthread_mutex_lock(&apool->lock);
+  while (true) {
+    while (apool->generation == seen && !apool->shutdown) {
+      pthread_cond_wait(&apool->start_cond, &apool->lock);
+    }
+    if (apool->shutdown) {
+      break;
+    }
+    seen = apool->generation;
+    pthread_mutex_unlock(&apool->lock);
+
+    runSlice(apool, warg->index);
+
+    pthread_mutex_lock(&apool->lock);
+    if (--apool->pending == 0) {
+      pthread_cond_signal(&apool->done_cond);
+    }
+  }
+  pthread_mutex_unlock(&apool->lock);
+  return NULL;
+}
+
+// Start nthreads - 1 worker threads; the caller is the first thread
+enum ResCodes initializeWorkerPool(struct worker_pool* apool, int nthreads) {
+  int i;
+
+  if (nthreads < 1 || nthreads > MAX_WORKER_THREADS) {
+    return RES_FAILED;
+  }
+  apool->nthreads = nthreads;
+  apool->generation = 0;
+  apool->pending = 0;
+  apool->shutdown = false;
+  pthread_mutex_init(&apool->lock, NULL);
+  pthread_cond_init(&apool->start_cond, NULL);
+  pthread_cond_init(&apool->done_cond, NULL);
+
+  for (i = 1; i < nthreads; i++) {
+    apool->args[i].pool = apool;
+    apool->args[i].index = i;
+    if (pthread_create(&apool->threads[i], NULL, workerMain,
+                       &apool->args[i]) != 0) {
+      apool->nthreads = i; // Only threads 1..i-1 are running
+      cleanupWorkerPool(apool);
+      return RES_FAILED;
+    }
+  }
+  return RES_OK;
+}
+
+// Stop and join all worker threads
+void cleanupWorkerPool(struct worker_pool* apool) {
+  int i;
+
+  pthread_mutex_lock(&apool->lock);
+  apool->shutdown = true;
+  pthread_cond_broadcast(&apool->start_cond);
+  pthread_mutex_unlock(&apool->lock);
+
+  for (i = 1; i < apool->nthreads; i++) {
+    pthread_join(apool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&apool->lock);
+  pthread_cond_destroy(&apool->start_cond);
+  pthread_cond_destroy(&apool->done_cond);
+}
+
+// Run task on all items 0..nitems-1, split into one slice per thread
+void runOnWorkers(struct worker_pool* apool, worker_task task, void* arg,
+                  int nitems) {
+  if (apool->nthreads == 1) {
+    task(arg, 0, nitems);
+    return;
+  }
+  pthread_mutex_lock(&apool->lock);
+  apool->task = task;
+  apool->arg = arg;
+  apool->nitems = nitems;
+  apool->pending = apool->nthreads - 1;
+  apool->generation++;
+  pthread_cond_broadcast(&apool->start_cond);
+  pthread_mutex_unlock(&apool->lock);
+
+  runSlice(apool, 0);
+
+  pthread_mutex_lock(&apool->lock);
+  while (apool->pending > 0) {
+    pthread_cond_wait(&apool->done_cond, &apool->lock);
+  }
+  pthread_mutex_unlock(&apool->lock);
+}
@@ -0,0 +1,58 @@
+// A simple variant of the game Snake
+//
+// Used for teaching in classes
+//
+// Author:
+// Franz Regensburger
+// Ingolstadt University of Applied Sciences
+// (C) 2011
+//
+// A pool of worker threads for data parallel loops.
+// runOnWorkers() splits the items 0..nitems-1 into one contiguous slice
+// per thread and returns when all slices are done. The calling thread
+// processes the first slice itself.
+
+#ifndef _WORKER_POOL_H
+#define _WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include "worm.h"
+
+#define MAX_WORKER_THREADS 64
+
+// Work on the items begin..end-1
+typedef void (*worker_task)(void* arg, int begin, int end);
+
+struct worker_pool;
+
+// Arguments of a worker thread
+struct worker_arg {
+  struct worker_pool* pool;
+  int index; // Number of the slice processed by this thread
+};
+
+struct worker_pool {
+  int nthreads;      // Number of threads including the calling thread
+  pthread_t threads[MAX_WORKER_THREADS];
+  struct worker_arg args[MAX_WORKER_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t start_cond; // Signalled when a new job is available
+  pthread_cond_t done_cond;  // Signalled when the last slice is done
+  long generation;           // Incremented for every job
+  int pending;               // Number of slices not yet done
+  bool shutdown;             // Tells the workers to terminate
+
+  // The current job
+  worker_task task;
+  void* arg;
+  int nitems;
+};
+
+extern enum ResCodes initializeWorkerPool(struct worker_pool* apool,
+                                          int nthreads);
+extern void cleanupWorkerPool(struct worker_pool* apool);
+extern void runOnWorkers(struct worker_pool* apool, worker_task task,
+                         void* arg, int nitems);
+
+#endif  // #define _WORKER_POOL_H
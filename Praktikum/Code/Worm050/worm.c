@@ -9,155 +9,796 @@
 //
 
 #include "worm.h"
+#include "autopilot.h"
 #include "board_model.h"
+#include "display.h"
+#include "feed.h"
+#include "game.h"
+#include "input_queue.h"
+#include "messages.h"
 #include "prep.h"
+#include "profiler.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "trace.h"
+#include "worker_pool.h"
 #include "worm_model.h"
 #include <curses.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
-void readUserInput(enum GameStates *agame_state);
-enum ResCodes doLevel();
+// Size of the board used by the headless benchmark
+#define BENCH_ROWS 24
+#define BENCH_COLS 80
+
+// Default file for snapshots of the game
+#define SNAPSHOT_FILE "worm.snp"
+
+// Settings from the command line
+struct options {
+  int ticks_per_second; // Tick rate of the game loop
+  int nthreads;         // Number of threads for stepping the worms
+  long bench_ticks;     // > 0: run the headless benchmark for so many ticks
+  char* record_file;    // Record the game into this file; NULL: no recording
+  char* replay_file;    // Replay this file headless; NULL: play interactively
+  long until_tick;      // Stop the replay after so many ticks; < 0: never
+  long keyframe_interval; // Ticks between keyframes in the recording
+  char* snapshot_file;  // File for snapshots of the game
+  bool resume;          // Continue the game saved in snapshot_file
+  long autosave_seconds; // Take a snapshot so often; 0: only on request
+  bool autopilot;       // Let the autopilot steer the user worm
+  char* trace_file;     // Trace the game loop into this file; NULL: no trace
+  enum RenderBackends renderer; // How the frames get to the terminal
+  char* feed_name;      // Publish the game for spectators; NULL: no feed
+  struct game_settings game; // Setup of the game; board size 0: window size
+};
+
+// Requests of the user besides the headings of the worm
+struct user_commands {
+  bool single_step; // Step only when the user presses a key
+  bool save;        // Take a snapshot of the game now
+  bool load;        // Continue from the last snapshot
+  bool autopilot;   // The autopilot steers the user worm
+  bool profile;     // Show the profile of the game loop
+  bool dismiss;     // Close the modal dialog
+};
+
+void readUserInput(struct game* agame, struct input_queue* aqueue,
+                   struct user_commands* acommands);
+void loadLastSnapshot(struct game* agame, struct snapshot_writer* awriter,
+                      struct replay_recorder* arecorder,
+                      struct feed_writer* afeed);
+void showEndOfGame(struct game* agame);
+void publishGame(struct feed_writer* afeed, struct game* agame,
+                 bool stepped);
+enum ResCodes doLevel(struct options* opts);
+enum ResCodes doBenchmark(struct options* opts);
+enum ResCodes doReplay(struct options* opts);
+void printUsage(char* progname);
+bool parseNumber(char* arg, long min, long* result);
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts);
 
 // ************************************
 // Management of the game
 // ************************************
 
-void readUserInput(enum GameStates *agame_state) {
+// Process all keys the user has pressed since the last call.
+// getch is non-blocking; we are called when stdin has become readable.
+// Direction keys are buffered in aqueue and applied tick by tick;
+// other requests are passed to the game loop in acommands.
+// While a modal dialog is open, any key closes it.
+void readUserInput(struct game* agame, struct input_queue* aqueue,
+                   struct user_commands* acommands) {
   int ch; // For storing the key codes
 
-  if ((ch = getch()) > 0) {
-    // Is there some user input?
-    // Blocking or non-blocking depends of config of getch
+  while ((ch = getch()) != ERR) {
+    if (isDialogModal()) {
+      acommands->dismiss = true; // The game does not see the key
+      continue;
+    }
     switch (ch) {
     case 'q': // User wants to end the show
-      *agame_state = WORM_GAME_QUIT;
-      break;
+      agame->game_state = WORM_GAME_QUIT;
+      return;
     case KEY_UP: // User wants up
-      setWormHeading(WORM_UP);
+      enqueueHeading(aqueue, WORM_UP);
       break;
     case KEY_DOWN: // User wants down
-      setWormHeading(WORM_DOWN);
+      enqueueHeading(aqueue, WORM_DOWN);
       break;
     case KEY_LEFT: // User wants left
-      setWormHeading(WORM_LEFT);
+      enqueueHeading(aqueue, WORM_LEFT);
       break;
-    case KEY_RIGHT:               // User wants right
-      setWormHeading(WORM_RIGHT); //@012
+    case KEY_RIGHT: // User wants right
+      enqueueHeading(aqueue, WORM_RIGHT);
       break;
-    case 's':                 // User wants single step
-      nodelay(stdscr, FALSE); // We simply make getch blocking @013
+    case 's': // User wants single step: each key press makes one step
+      acommands->single_step = true;
       break;
-    case ' ': // Terminate single step; make getch non-blocking again
-      nodelay(stdscr, TRUE); // Make getch non-blocking again
+    case ' ': // Terminate single step
+      acommands->single_step = false;
+      break;
+    case 'w': // User wants to save the game
+      acommands->save = true;
+      break;
+    case 'l': // User wants to continue from the last saved game
+      acommands->load = true;
+      break;
+    case 'a': // User wants to hand over to the autopilot or take over again
+      acommands->autopilot = !acommands->autopilot;
+      break;
+    case 'p': // User wants to see the profile of the game loop or not
+      acommands->profile = !acommands->profile;
       break;
     }
   }
   return;
 }
 
-enum ResCodes doLevel() {
-  enum GameStates game_state; // The current game_state
+// Replace the running game by the last snapshot and show it
+void loadLastSnapshot(struct game* agame, struct snapshot_writer* awriter,
+                      struct replay_recorder* arecorder,
+                      struct feed_writer* afeed) {
+  struct pos headpos;
 
-  enum ResCodes res_code; // Result code from functions
-  bool end_level_loop;    // Indicates whether we should leave the main loop
+  if (arecorder->file != NULL) {
+    // The replay file cannot express a jump in time
+    showNotice("Laden ist waehrend einer Aufzeichnung nicht moeglich");
+    return;
+  }
+  // The last snapshot might still be on its way to the disk
+  waitForSnapshots(awriter);
+  if (loadSnapshot(awriter->filename, agame) != RES_OK) {
+    showNotice("Kein passender Spielstand gefunden");
+    return;
+  }
+  headpos = getWormHeadPos(&agame->worms, USER_WORM_ID);
+  followPos(headpos.y, headpos.x);
+  drawViewport(&agame->board);
+  republishBoard(afeed, &agame->board);
+  showNotice("Spielstand geladen");
+}
+
+// Pass the state of the user worm and, if the game has been stepped,
+// the changes of this tick to the spectators
+void publishGame(struct feed_writer* afeed, struct game* agame,
+                 bool stepped) {
+  struct feed_status status;
+  struct pos headpos = getWormHeadPos(&agame->worms, USER_WORM_ID);
+
+  status.tick = agame->tick;
+  status.game_state = agame->game_state;
+  status.head_y = headpos.y;
+  status.head_x = headpos.x;
+  status.length = getWormLength(&agame->worms, USER_WORM_ID);
+  publishFrame(afeed, stepped ? &agame->board.changes : NULL, &status);
+}
 
-  int bottomLeft_y, bottomLeft_x; // Start positions of the worm
+// Tell the user why the game is over by a modal dialog.
+// The game loop ends when the dialog is closed.
+void showEndOfGame(struct game* agame) {
+  switch (agame->game_state) {
+  case WORM_GAME_QUIT:
+    openDialog(&agame->board, DIALOG_MODAL,
+               "Sie haben die aktuelle Runde beendet!",
+               "Bitte Taste druecken");
+    break;
+  case WORM_OUT_OF_BOUNDS:
+    openDialog(&agame->board, DIALOG_MODAL,
+               "Sie haben das Spiel verloren,"
+               " weil Sie das Spielfeld verlassen haben",
+               "Bitte Taste druecken");
+    break;
+  case WORM_CROSSING:
+    openDialog(&agame->board, DIALOG_MODAL,
+               "Sie haben das Spiel verloren,"
+               " weil Sie einen Wurm gekreuzt haben",
+               "Bitte Taste druecken");
+    break;
+  default:
+    openDialog(&agame->board, DIALOG_MODAL, "Interner Fehler!",
+               "Bitte Taste druecken");
+  }
+}
 
-  // At the beginnung of the level, we still have a chance to win
-  game_state = WORM_GAME_ONGOING;
+enum ResCodes doLevel(struct options* opts) {
+  struct game thegame;      // The complete state of the game
+  struct scheduler sched;   // Deadlines of the ticks
+  struct input_queue inputq; // Direction keys not yet applied
+  struct worker_pool pool;   // Threads for stepping the worms
+  struct replay_recorder recorder; // Writes the input into a replay file
+  struct snapshot_writer snapshots; // Writes snapshots in the background
+  struct autopilot pilot;    // Steers the user worm on request
+  struct profiler profiler;  // Times the phases of the ticks
+  struct tracer tracer;      // Writes the phases into a trace file
+  struct feed_writer feed;   // Shows the game to spectators
 
-  // There is always an initialized user worm.
-  // Initialize the userworm with its size, position, heading.
-  bottomLeft_y = getLastRow();
-  bottomLeft_x = 0;
-  res_code = initializeWorm(WORM_LENGTH, bottomLeft_y, bottomLeft_x, WORM_RIGHT,
-                            COLP_USER_WORM_HEAD);
+  enum ResCodes res_code; // Result code from functions
+  bool end_level_loop;    // Indicates whether we should leave the main loop
+  struct user_commands commands; // Requests of the user
+  enum SchedulerEvents event; // Why we have stopped waiting
+  bool profile_shown;     // The profile is on the display
+  bool tracing;           // The phases go into the trace file
+  struct pos headpos;     // Position of the user worm's head
+  long autosave_ticks;    // Ticks between automatic snapshots; 0: none
 
+  // Set up the game. Without a size from the command line the board fills
+  // the window above the message area. A larger board is shown through
+  // a viewport that follows the user worm.
+  if (opts->game.nrows == 0) {
+    opts->game.nrows = getLayout()->board_rows;
+    opts->game.ncols = getLayout()->ncols;
+  }
+  res_code = initializeGame(&thegame, &opts->game);
   if (res_code != RES_OK) {
     return res_code;
   }
+  // Continue a saved game; opts->game holds its settings already
+  if (opts->resume &&
+      loadSnapshot(opts->snapshot_file, &thegame) != RES_OK) {
+    cleanupGame(&thegame);
+    return RES_FAILED;
+  }
+  setViewport(&thegame.board, getLayout()->board_rows, getLayout()->ncols);
 
-  // Show worm at its initial position
-  showWorm();
+  recorder.file = NULL;
+  if (opts->record_file != NULL &&
+      startRecording(&recorder, opts->record_file, &thegame,
+                     opts->keyframe_interval) != RES_OK) {
+    cleanupGame(&thegame);
+    return RES_FAILED;
+  }
+  if (initializeScheduler(&sched, opts->ticks_per_second) != RES_OK ||
+      initializeWorkerPool(&pool, opts->nthreads) != RES_OK) {
+    stopRecording(&recorder);
+    cleanupGame(&thegame);
+    return RES_FAILED;
+  }
+  if (initializeSnapshotWriter(&snapshots, opts->snapshot_file, &thegame) !=
+      RES_OK) {
+    cleanupWorkerPool(&pool);
+    stopRecording(&recorder);
+    cleanupGame(&thegame);
+    return RES_FAILED;
+  }
+  // The search arrays of the autopilot are allocated when it takes over
+  initializeAutopilot(&pilot, &thegame);
+  if (opts->autopilot && prepareAutopilot(&pilot) != RES_OK) {
+    cleanupSnapshotWriter(&snapshots);
+    cleanupWorkerPool(&pool);
+    stopRecording(&recorder);
+    cleanupGame(&thegame);
+    return RES_FAILED;
+  }
+  setGameWorkers(&thegame, &pool);
+  autosave_ticks = opts->autosave_seconds * opts->ticks_per_second;
 
   // Display all what we have set up until now
-  refresh();
+  showBorderLine();
+  followPos(getWormHeadPos(&thegame.worms, USER_WORM_ID).y,
+            getWormHeadPos(&thegame.worms, USER_WORM_ID).x);
+  drawViewport(&thegame.board);
+  showStatus(&thegame.worms, USER_WORM_ID);
+  flushFrame();
+  presentFrame();
 
   // Start the loop for this level
   end_level_loop = false; // Flag for controlling the main loop
+  commands.single_step = false;
+  commands.save = false;
+  commands.load = false;
+  commands.autopilot = opts->autopilot;
+  commands.profile = false;
+  commands.dismiss = false;
+  profile_shown = false;
+  initializeInputQueue(&inputq);
+  // The trace starts before the first phase
+  tracing = opts->trace_file != NULL &&
+            startTracing(&tracer, opts->trace_file) == RES_OK;
+  if (opts->trace_file != NULL && !tracing) {
+    showNotice("Trace-Datei kann nicht geschrieben werden");
+  }
+  feed.header = NULL; // publishFrame does nothing then
+  if (opts->feed_name != NULL &&
+      startFeed(&feed, opts->feed_name, &thegame.board) != RES_OK) {
+    showNotice("Feed fuer Zuschauer kann nicht angelegt werden");
+  }
+  initializeProfiler(&profiler, sched.period_ns);
+  if (tracing) {
+    setProfileTracer(&profiler, &tracer);
+  }
   while (!end_level_loop) {
-    // Process optional user input
-    readUserInput(&game_state);
-    if (game_state == WORM_GAME_QUIT) {
-      end_level_loop = true; //@014
-      continue; // Go to beginning of the loop's block and check loop condition
+    // Sleep until the next tick is due or the user presses a key
+    event = waitForTickOrInput(&sched, STDIN_FILENO, commands.single_step);
+    endPhase(&profiler, PHASE_SLEEP);
+    // The window may have changed its size: show the message area at
+    // its new place; of the board only what has become visible
+    if (resizeDisplay(&thegame.board)) {
+      relayoutDialog(&thegame.board);
+      relayoutMessageArea();
+      showStatus(&thegame.worms, USER_WORM_ID);
+      if (profile_shown) {
+        showProfile(&profiler);
+      }
+      drawDialog();
+      flushFrame();
+      presentFrame();
+      endPhase(&profiler, PHASE_RENDER);
     }
-    // Process userworm
-    // Clean the tail of the worm
-    cleanWormTail();
-    // Now move the worm for one step
-    moveWorm(&game_state);
-    // Bail out of the loop if something bad happened
-    if (game_state != WORM_GAME_ONGOING) {
-      end_level_loop = true; //@016
-      continue; // Go to beginning of the loop's block and check loop condition
+    if (event == SCHED_INTERRUPTED) {
+      continue; // Wait for the tick
     }
-    // Show the worm at its new position
-    showWorm();
-    // END process userworm
-
-    // Sleep a bit before we show the updated window
-    napms(NAP_TIME);
+    if (event == SCHED_INPUT_READY) {
+      // Process user input at once
+      readUserInput(&thegame, &inputq, &commands);
+      if (commands.dismiss) {
+        commands.dismiss = false;
+        closeDialog(&thegame.board);
+        if (thegame.game_state != WORM_GAME_ONGOING) {
+          // The user has read why the game is over
+          end_level_loop = true;
+          continue; // Go to beginning of the loop's block and check loop condition
+        }
+      }
+      if (thegame.game_state == WORM_GAME_QUIT && !isDialogModal()) {
+        recordQuit(&recorder, &thegame);
+        publishGame(&feed, &thegame, false);
+        showEndOfGame(&thegame);
+      }
+      if (commands.save) {
+        commands.save = false;
+        showNotice(saveSnapshot(&snapshots, &thegame) == RES_OK
+                       ? "Spielstand gespeichert"
+                       : "Speichern fehlgeschlagen");
+      }
+      if (commands.load) {
+        commands.load = false;
+        // Keys pressed before belong to the old game
+        initializeInputQueue(&inputq);
+        loadLastSnapshot(&thegame, &snapshots, &recorder, &feed);
+      }
+      if (commands.profile != profile_shown) {
+        profile_shown = commands.profile;
+        showProfile(profile_shown ? &profiler : NULL);
+      }
+      if (!commands.single_step) {
+        // Show notices, dialogs and a loaded game at once
+        drawDialog();
+        flushFrame();
+        presentFrame();
+        endPhase(&profiler, PHASE_INPUT);
+        continue; // Wait for the tick
+      }
+      // Single step: every key press makes one step
+    }
+    // The game stands still while it is over or a modal dialog is open;
+    // the loop goes on ticking and displaying
+    if (thegame.game_state == WORM_GAME_ONGOING && !isDialogModal()) {
+      if (commands.autopilot && prepareAutopilot(&pilot) != RES_OK) {
+        // Handed over for the first time, but there is no memory for it
+        showNotice("Kein Speicher fuer den Autopiloten");
+        commands.autopilot = false;
+      }
+      if (commands.autopilot) {
+        // Keys pressed for the user worm do not count now
+        initializeInputQueue(&inputq);
+        steerAutopilot(&pilot, &thegame);
+      } else {
+        // At most one change of the heading per tick
+        applyNextHeading(&inputq, &thegame.worms, USER_WORM_ID);
+      }
+      recordTick(&recorder, &thegame);
+      endPhase(&profiler, PHASE_INPUT);
+      // Process all worms: clean tails, move and show them.
+      // The halves of stepGame are called one by one for the profile.
+      stepGameTails(&thegame);
+      endPhase(&profiler, PHASE_TAILS);
+      stepGameMoves(&thegame);
+      endPhase(&profiler, PHASE_MOVE);
+      if (thegame.game_state != WORM_GAME_ONGOING) {
+        // Something bad happened
+        showEndOfGame(&thegame);
+      } else if (autosave_ticks > 0 && thegame.tick % autosave_ticks == 0 &&
+                 saveSnapshot(&snapshots, &thegame) != RES_OK) {
+        // Save the game now and then; the disk is left to the writer thread
+        openDialog(&thegame.board, DIALOG_TOAST,
+                   "Automatisches Speichern fehlgeschlagen", NULL);
+      }
+      // Put the changes of this step onto the display.
+      // If the viewport has to follow the user worm, redraw all of it.
+      headpos = getWormHeadPos(&thegame.worms, USER_WORM_ID);
+      if (followPos(headpos.y, headpos.x)) {
+        drawViewport(&thegame.board);
+      } else {
+        drawChanges(&thegame.board.changes);
+      }
+      publishGame(&feed, &thegame, true);
+    }
+    // The dialog covers the board
+    tickDialog(&thegame.board);
+    drawDialog();
+    showStatus(&thegame.worms, USER_WORM_ID);
+    showAutopilotStatus(commands.autopilot ? &pilot : NULL, sched.period_ns);
+    if (!commands.profile) {
+      showTickStatus(&sched);
+      showRenderStatus();
+    } else if (isProfileHudDue(&profiler)) {
+      // A few updates per second: the HUD must not eat the budget it shows
+      showProfile(&profiler);
+    }
+    flushFrame();
+    endPhase(&profiler, PHASE_RENDER);
 
     // Display all the updates
-    refresh();
+    presentFrame();
+    endPhase(&profiler, PHASE_REFRESH);
+    endProfiledTick(&profiler);
+
+    // Compute the deadline of the next tick
+    if (commands.single_step) {
+      // We waited for the user, not for the clock
+      restartScheduler(&sched);
+    } else {
+      finishTick(&sched);
+    }
 
     // Start next iteration
   }
 
-  // Preset res_code for rest of the function
-  res_code = RES_OK;
+  // Preset res_code for rest of the function.
+  // Only an internal error is a failure (see showEndOfGame).
+  res_code = thegame.game_state == WORM_OUT_OF_MEMORY ? RES_FAILED : RES_OK;
+  if (tracing) {
+    setProfileTracer(&profiler, NULL);
+    if (stopTracing(&tracer) != RES_OK) {
+      res_code = RES_FAILED;
+    }
+  }
 
-  // For some reason we left the control loop of the current level.
-  // However, in this version we do not yet check for the reason.
-  // There is no user feedback at the moment!
+  if (stopRecording(&recorder) != RES_OK) {
+    res_code = RES_FAILED;
+  }
+  stopFeed(&feed);
+  cleanupAutopilot(&pilot);
+  cleanupSnapshotWriter(&snapshots);
+  cleanupGame(&thegame);
+  cleanupWorkerPool(&pool);
 
   // Normal exit point
   return res_code;
 }
 
+// ************************************
+// Headless benchmark
+// ************************************
+
+// Run opts->bench_ticks steps of the simulation without curses and without
+// sleeping. Prints the achieved number of ticks per second.
+enum ResCodes doBenchmark(struct options* opts) {
+  long nticks = opts->bench_ticks;
+  struct game thegame;
+  struct worker_pool pool;
+  struct autopilot pilot;
+  struct timespec start, stop;
+  double seconds;
+  long i;
+  long restarts = 0;
+  uint64_t checksum;
+  struct game_settings settings = opts->game;
+
+  if (initializeWorkerPool(&pool, opts->nthreads) != RES_OK) {
+    return RES_FAILED;
+  }
+  if (initializeGame(&thegame, &opts->game) != RES_OK) {
+    cleanupWorkerPool(&pool);
+    return RES_FAILED;
+  }
+  initializeAutopilot(&pilot, &thegame);
+  if (opts->autopilot && prepareAutopilot(&pilot) != RES_OK) {
+    cleanupGame(&thegame);
+    cleanupWorkerPool(&pool);
+    return RES_FAILED;
+  }
+  setGameWorkers(&thegame, &pool);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < nticks; i++) {
+    if (opts->autopilot) {
+      steerAutopilot(&pilot, &thegame);
+    } else if (opts->game.nworms == 1) {
+      steerAlongBorder(&thegame);
+    } else {
+      // Among other worms the user worm has to dodge like a bot
+      steerBot(&thegame, USER_WORM_ID);
+    }
+    stepGame(&thegame);
+    if (thegame.game_state != WORM_GAME_ONGOING) {
+      // Start over with a fresh game
+      restarts++;
+      cleanupGame(&thegame);
+      settings.seed = opts->game.seed + restarts;
+      if (initializeGame(&thegame, &settings) != RES_OK) {
+        cleanupAutopilot(&pilot);
+        cleanupWorkerPool(&pool);
+        return RES_FAILED;
+      }
+      setGameWorkers(&thegame, &pool);
+      resetAutopilot(&pilot, &thegame);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  checksum = hashGame(&thegame);
+  cleanupGame(&thegame);
+  cleanupWorkerPool(&pool);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  printf("Ticks: %ld  Neustarts: %ld  Zeit: %.3f s  Ticks/s: %.0f\n", nticks,
+         restarts, seconds, seconds > 0 ? nticks / seconds : 0.0);
+  // Runs with the same seed must end in the same state
+  printf("Threads: %d  Pruefsumme: %016llx\n", opts->nthreads,
+         (unsigned long long)checksum);
+  if (opts->autopilot) {
+    printf("Autopilot: %ld Entscheidungen  Mittel: %.1f us  Max: %.1f us\n",
+           pilot.decisions,
+           pilot.decisions > 0 ? pilot.total_ns / pilot.decisions / 1e3 : 0.0,
+           pilot.max_ns / 1e3);
+  }
+  cleanupAutopilot(&pilot);
+  return RES_OK;
+}
+
+// ************************************
+// Headless replay
+// ************************************
+
+// Run the game recorded in opts->replay_file without curses and without
+// sleeping, at most up to tick opts->until_tick.
+// With a tick to stop at we start at the last keyframe before it.
+// A truncated recording is replayed up to its last recorded tick only.
+// Prints the state in which the game ended and the number of ticks.
+enum ResCodes doReplay(struct options* opts) {
+  struct replay_player player;
+  struct game thegame;
+  struct worker_pool pool;
+  struct timespec start, stop;
+  double seconds;
+  long start_tick;
+
+  if (openReplay(&player, opts->replay_file) != RES_OK) {
+    fprintf(stderr, "Ungueltige Aufzeichnung: %s\n", opts->replay_file);
+    return RES_FAILED;
+  }
+  if (initializeWorkerPool(&pool, opts->nthreads) != RES_OK) {
+    closeReplay(&player);
+    return RES_FAILED;
+  }
+  if (initializeGame(&thegame, &player.settings) != RES_OK) {
+    cleanupWorkerPool(&pool);
+    closeReplay(&player);
+    return RES_FAILED;
+  }
+  setGameWorkers(&thegame, &pool);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (opts->until_tick >= 0 &&
+      seekReplay(&player, &thegame, opts->until_tick) != RES_OK) {
+    fprintf(stderr, "Ungueltiger Keyframe in %s\n", opts->replay_file);
+    cleanupGame(&thegame);
+    cleanupWorkerPool(&pool);
+    closeReplay(&player);
+    return RES_FAILED;
+  }
+  start_tick = thegame.tick;
+  while (thegame.game_state == WORM_GAME_ONGOING &&
+         (opts->until_tick < 0 || thegame.tick < opts->until_tick) &&
+         hasReplayInput(&player, &thegame)) {
+    // The recorded input takes the place of the keyboard
+    replayTick(&player, &thegame);
+    stepGame(&thegame);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+  printf("Spielzustand: %s  Ticks: %ld\n", gameStateName(thegame.game_state),
+         thegame.tick);
+  if (!hasReplayInput(&player, &thegame)) {
+    printf("Aufzeichnung unvollstaendig: Eingaben nur bis Tick %ld\n",
+           player.next_tick);
+  }
+  printf("Start bei Tick: %ld  Zeit: %.3f s  Ticks/s: %.0f\n", start_tick,
+         seconds, seconds > 0 ? (thegame.tick - start_tick) / seconds : 0.0);
+  printf("Pruefsumme: %016llx\n", (unsigned long long)hashGame(&thegame));
+
+  cleanupGame(&thegame);
+  cleanupWorkerPool(&pool);
+  closeReplay(&player);
+  return RES_OK;
+}
+
 // ********************************************************************************************
 // MAIN
 // ********************************************************************************************
 
-int main(void) {
+// Print how to call the program
+void printUsage(char* progname) {
+  fprintf(stderr,
+          "Aufruf: %s [--rate TICKS_PRO_SEKUNDE] [--worms N] [--seed S]\n"
+          "          [--length L] [--threads N] [--board ZEILENxSPALTEN]\n"
+          "          [--bench N] [--record DATEI [--keyframes K]]\n"
+          "          [--replay DATEI [--until T]]\n"
+          "          [--snapshot DATEI] [--autosave S] [--resume DATEI]\n"
+          "          [--autopilot] [--trace DATEI] [--renderer curses|ansi]\n"
+          "          [--feed NAME]\n",
+          progname);
+}
+
+// Parse a number >= min; returns false if arg is not such a number
+bool parseNumber(char* arg, long min, long* result) {
+  char* end;
+  *result = strtol(arg, &end, 10);
+  return *arg != '\0' && *end == '\0' && *result >= min;
+}
+
+// Process the command line options into *opts.
+// Returns RES_FAILED if the command line is invalid.
+enum ResCodes parseOptions(int argc, char* argv[], struct options* opts) {
+  long value;
+  int i;
+
+  // Defaults
+  opts->ticks_per_second = 1000 / NAP_TIME;
+  defaultGameSettings(&opts->game);
+  opts->game.nrows = 0;
+  opts->game.ncols = 0;
+  opts->game.seed = (uint64_t)time(NULL);
+  opts->nthreads = 1;
+  opts->bench_ticks = 0;
+  opts->record_file = NULL;
+  opts->replay_file = NULL;
+  opts->until_tick = -1;
+  opts->keyframe_interval = REPLAY_KEYFRAME_INTERVAL;
+  opts->snapshot_file = SNAPSHOT_FILE;
+  opts->resume = false;
+  opts->autosave_seconds = 0;
+  opts->autopilot = false;
+  opts->trace_file = NULL;
+  opts->renderer = RENDER_CURSES;
+  opts->feed_name = NULL;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--autopilot") == 0) {
+      opts->autopilot = true;
+      continue; // The only option without an argument
+    }
+    if (i + 1 == argc) {
+      return RES_FAILED; // All other options have an argument
+    }
+    if (strcmp(argv[i], "--bench") == 0 &&
+        parseNumber(argv[i + 1], 1, &value)) {
+      opts->bench_ticks = value;
+    } else if (strcmp(argv[i], "--rate") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->ticks_per_second = (int)value;
+    } else if (strcmp(argv[i], "--worms") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) && value <= MAX_WORMS) {
+      opts->game.nworms = (int)value;
+    } else if (strcmp(argv[i], "--length") == 0 &&
+               parseNumber(argv[i + 1], 1, &value)) {
+      opts->game.worm_length = value;
+    } else if (strcmp(argv[i], "--threads") == 0 &&
+               parseNumber(argv[i + 1], 1, &value) &&
+               value <= MAX_WORKER_THREADS) {
+      opts->nthreads = (int)value;
+    } else if (strcmp(argv[i], "--seed") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->game.seed = (uint64_t)value;
+    } else if (strcmp(argv[i], "--record") == 0) {
+      opts->record_file = argv[i + 1];
+    } else if (strcmp(argv[i], "--replay") == 0) {
+      opts->replay_file = argv[i + 1];
+    } else if (strcmp(argv[i], "--keyframes") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->keyframe_interval = value;
+    } else if (strcmp(argv[i], "--snapshot") == 0) {
+      opts->snapshot_file = argv[i + 1];
+    } else if (strcmp(argv[i], "--resume") == 0) {
+      opts->snapshot_file = argv[i + 1];
+      opts->resume = true;
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "curses") == 0) {
+      opts->renderer = RENDER_CURSES;
+    } else if (strcmp(argv[i], "--renderer") == 0 &&
+               strcmp(argv[i + 1], "ansi") == 0) {
+      opts->renderer = RENDER_ANSI;
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      opts->trace_file = argv[i + 1];
+    } else if (strcmp(argv[i], "--feed") == 0) {
+      opts->feed_name = argv[i + 1];
+    } else if (strcmp(argv[i], "--autosave") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->autosave_seconds = value;
+    } else if (strcmp(argv[i], "--until") == 0 &&
+               parseNumber(argv[i + 1], 0, &value)) {
+      opts->until_tick = value;
+    } else if (strcmp(argv[i], "--board") == 0 &&
+               parseBoardSize(argv[i + 1], MAX_BOARD_CELLS, &opts->game.nrows,
+                              &opts->game.ncols)) {
+      // Nothing more to do
+    } else {
+      fprintf(stderr, "Ungueltige Option: %s %s\n", argv[i], argv[i + 1]);
+      return RES_FAILED;
+    }
+    i++; // Skip the argument of the option
+  }
+  if (opts->resume && opts->record_file != NULL) {
+    // A recording has to start with a new game
+    fprintf(stderr, "--resume und --record schliessen sich aus\n");
+    return RES_FAILED;
+  }
+  return RES_OK;
+}
+
+int main(int argc, char* argv[]) {
   enum ResCodes res_code; // Result code from functions
+  struct options opts;    // Settings from the command line
+
+  if (parseOptions(argc, argv, &opts) != RES_OK) {
+    printUsage(argv[0]);
+    return RES_FAILED;
+  }
+
+  // Headless benchmark: worm --bench N
+  if (opts.bench_ticks > 0) {
+    if (opts.game.nrows == 0) {
+      opts.game.nrows = BENCH_ROWS;
+      opts.game.ncols = BENCH_COLS;
+    }
+    return doBenchmark(&opts);
+  }
+
+  // Headless replay: worm --replay FILE
+  if (opts.replay_file != NULL) {
+    return doReplay(&opts);
+  }
+
+  // Continue a saved game with its own settings
+  if (opts.resume &&
+      readSnapshotSettings(opts.snapshot_file, &opts.game) != RES_OK) {
+    fprintf(stderr, "Ungueltiger Spielstand: %s\n", opts.snapshot_file);
+    return RES_FAILED;
+  }
 
   // Here we start
   initializeCursesApplication(); // Init various settings of our application
 
   // Maximal LINES and COLS are set by curses for the current window size.
-  // Note: we do not cope with resizing in this simple examples!
+  // Later changes of the size are handled by the display (see display.h).
 
   // Check if the window is large enough to display messages in the message area
   // a has space for at least one line for the worm
-  if (LINES < MIN_NUMBER_OF_ROWS || COLS < MIN_NUMBER_OF_COLS) {
+  if (LINES < ROWS_RESERVED + MIN_NUMBER_OF_ROWS ||
+      COLS < MIN_NUMBER_OF_COLS) {
     // Since we not even have the space for displaying messages
     // we print a conventional error message via printf after
     // the call of cleanupCursesApp()
     cleanupCursesApp();
     printf("Das Fenster ist zu klein: wir brauchen mindestens %dx%d\n",
-           MIN_NUMBER_OF_COLS, MIN_NUMBER_OF_ROWS);
+           MIN_NUMBER_OF_COLS, MIN_NUMBER_OF_ROWS + ROWS_RESERVED);
+    res_code = RES_FAILED;
+  } else if (initializeDisplay(opts.renderer) != RES_OK) {
+    cleanupCursesApp();
     res_code = RES_FAILED;
   } else {
-    res_code = doLevel();
+    res_code = doLevel(&opts);
+    cleanupDisplay();
     cleanupCursesApp();
   }
 
-  return res_code; //@001
+  return res_code;
 }
@@ -17,28 +17,49 @@ enum ResCodes {
 };
 
 // Dimensions and bounds
-#define NAP_TIME 100 // Time in milliseconds to sleep between updates of display
+#define NAP_TIME 100 // Default length of a tick in milliseconds
 #define MIN_NUMBER_OF_ROWS                                                     \
   3 // The guaranteed number of rows available for the board
 #define MIN_NUMBER_OF_COLS                                                     \
   10 // The guaranteed number of columns available for the board
-#define WORM_LENGTH 20 // Maximal length of the worm
-// Unused element in the worm arrays of positions
-#define UNUSED_POS_ELEM -1
+#define ROWS_RESERVED                                                          \
+  4 // Rows at the bottom of the window reserved for the message area
+#define WORM_LENGTH 20 // Default length of a worm when fully grown
+
+// A position on the board
+struct pos {
+  int y; // y-coordinate (row)
+  int x; // x-coordinate (column)
+};
+
+// Codes for the content of a cell on the board
+enum BoardCodes {
+  BC_FREE_CELL,
+  BC_USED_BY_WORM,
+};
 
 // Numbers for color pairs used by curses macro COLOR_PAIR
-enum ColorPairs { COLP_USER_WORM = 1, COLP_FREE_CELL, COLP_USER_WORM_HEAD };
+enum ColorPairs {
+  COLP_USER_WORM = 1,
+  COLP_FREE_CELL,
+  COLP_USER_WORM_HEAD,
+  COLP_BARRIER,
+  COLP_MESSAGE,
+  COLP_BOT_WORM,
+};
 
 // Symbols to display
 #define SYMBOL_WORM_INNER_ELEMENT 'o'
 #define SYMBOL_FREE_CELL ' '
 #define SYMBOL_WORM_HEAD 'O'
+#define SYMBOL_BARRIER '#'
 // Game state codes
 enum GameStates {
   WORM_GAME_ONGOING,
   WORM_OUT_OF_BOUNDS,
   WORM_CROSSING,
   WORM_GAME_QUIT,
+  WORM_OUT_OF_MEMORY,
 };
 
 #endif // #define _WORM_H
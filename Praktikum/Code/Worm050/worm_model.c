@@ -8,170 +8,526 @@
 // (C) 2011
 //
 // The worm model
+// Note: the model never calls curses. All changes go to the board model.
+#include <stdlib.h>
+
 #include "worm_model.h"
 #include "board_model.h"
 #include "worm.h"
-#include <curses.h>
-
-int theworm_maxindex;
-int theworm_headindex;
-int theworm_wormpos_x[WORM_LENGTH];
-int theworm_wormpos_y[WORM_LENGTH];
-int theworm_dx;
-int theworm_dy;
-enum ColorPairs theworm_wcolor;
-
-// Initialize the worm
-extern enum ResCodes initializeWorm(int len_max, int headpos_y, int headpos_x,
-                                    enum WormHeading dir,
-                                    enum ColorPairs color) {
-  // Local variables for loops etc.
-  int i;                          // @001
-                                  // Initialize last usable index to len_max -1
-                                  // theworm_maxindex
-  theworm_maxindex = len_max - 1; //@002
-                                  // Initialize headindex
-  theworm_headindex = 0;
-
-  // Mark all elements as unused in the arrays of positions
-  // theworm_wormpos_y[] and theworm_wormpos_x[]
-  // An unused position in the array is marked
-  // with code UNUSED_POS_ELEM
-  for (i = 0; i <= theworm_maxindex; i++) {
-    theworm_wormpos_y[i] = UNUSED_POS_ELEM; //@004
-    theworm_wormpos_x[i] = UNUSED_POS_ELEM; //@004
-  }
-  // Initialize position of worms head
-  theworm_wormpos_x[theworm_headindex] = headpos_x; //@005
-  theworm_wormpos_y[theworm_headindex] =
-      headpos_y; //@005
-                 // Initialize the heading of the worm
-  setWormHeading(dir);
-  // Initialize color of the worm
-  theworm_wcolor = color;
 
+// Initialize an empty table for up to capacity worms
+extern enum ResCodes initializeWormTable(struct worm_table* atable,
+                                         int capacity) {
+  atable->nworms = 0;
+  atable->capacity = capacity;
+  atable->headpos = malloc(capacity * sizeof(struct pos));
+  atable->dx = malloc(capacity * sizeof(int));
+  atable->dy = malloc(capacity * sizeof(int));
+  atable->heading = malloc(capacity * sizeof(enum WormHeading));
+  atable->state = malloc(capacity * sizeof(enum GameStates));
+  atable->on_board = malloc(capacity * sizeof(bool));
+  atable->wcolor = malloc(capacity * sizeof(enum ColorPairs));
+  atable->nextpos = malloc(capacity * sizeof(struct pos));
+  atable->tail_chunk = malloc(capacity * sizeof(struct body_chunk*));
+  atable->tail_off = malloc(capacity * sizeof(int));
+  atable->head_chunk = malloc(capacity * sizeof(struct body_chunk*));
+  atable->head_off = malloc(capacity * sizeof(int));
+  atable->length = malloc(capacity * sizeof(long));
+  atable->max_length = malloc(capacity * sizeof(long));
+  atable->neckpos = malloc(capacity * sizeof(struct pos));
+  // Enough chunks for worms of the default length
+  if (initializeChunkPool(&atable->pool,
+                          (long)capacity *
+                              ((WORM_LENGTH + CHUNK_LENGTH - 1) / CHUNK_LENGTH +
+                               1)) != RES_OK) {
+    atable->pool.slabs = NULL;
+    cleanupWormTable(atable);
+    return RES_FAILED;
+  }
+
+  if (atable->headpos == NULL || atable->dx == NULL || atable->dy == NULL ||
+      atable->heading == NULL || atable->state == NULL ||
+      atable->on_board == NULL || atable->wcolor == NULL ||
+      atable->nextpos == NULL || atable->tail_chunk == NULL ||
+      atable->tail_off == NULL || atable->head_chunk == NULL ||
+      atable->head_off == NULL || atable->length == NULL ||
+      atable->max_length == NULL || atable->neckpos == NULL) {
+    cleanupWormTable(atable);
+    return RES_FAILED;
+  }
   return RES_OK;
 }
 
-// Show the worms's elements on the display
+// Free the table and the bodies of all worms
+extern void cleanupWormTable(struct worm_table* atable) {
+  free(atable->headpos);
+  free(atable->dx);
+  free(atable->dy);
+  free(atable->heading);
+  free(atable->state);
+  free(atable->on_board);
+  free(atable->wcolor);
+  free(atable->nextpos);
+  free(atable->tail_chunk);
+  free(atable->tail_off);
+  free(atable->head_chunk);
+  free(atable->head_off);
+  free(atable->length);
+  free(atable->max_length);
+  free(atable->neckpos);
+  cleanupChunkPool(&atable->pool);
+  atable->headpos = NULL;
+  atable->dx = atable->dy = NULL;
+  atable->heading = NULL;
+  atable->state = NULL;
+  atable->on_board = NULL;
+  atable->wcolor = NULL;
+  atable->nextpos = NULL;
+  atable->tail_chunk = atable->head_chunk = NULL;
+  atable->tail_off = atable->head_off = NULL;
+  atable->length = atable->max_length = NULL;
+  atable->neckpos = NULL;
+  atable->nworms = 0;
+}
+
+// Append a new head element to the body of worm id.
+// Returns false if no chunk is available.
+static bool pushHead(struct worm_table* atable, int id, struct pos headpos) {
+  if (atable->head_off[id] == CHUNK_LENGTH - 1) {
+    // The head chunk is full: chain a new one
+    struct body_chunk* chunk = allocChunk(&atable->pool);
+    if (chunk == NULL) {
+      return false;
+    }
+    atable->head_chunk[id]->next = chunk;
+    atable->head_chunk[id] = chunk;
+    atable->head_off[id] = -1;
+  }
+  atable->head_off[id]++;
+  atable->head_chunk[id]->elems[atable->head_off[id]] = headpos;
+  atable->headpos[id] = headpos;
+  atable->length[id]++;
+  return true;
+}
+
+// Remove the tail element from the body of worm id
+static void popTail(struct worm_table* atable, int id) {
+  atable->tail_off[id]++;
+  atable->length[id]--;
+  if (atable->tail_off[id] == CHUNK_LENGTH) {
+    struct body_chunk* chunk = atable->tail_chunk[id];
+    if (chunk == atable->head_chunk[id]) {
+      // The body is empty now; reuse the chunk for the next head
+      atable->tail_off[id] = 0;
+      atable->head_off[id] = -1;
+    } else {
+      // The tail chunk is used up: give it back to the pool
+      atable->tail_chunk[id] = chunk->next;
+      atable->tail_off[id] = 0;
+      releaseChunk(&atable->pool, chunk);
+    }
+  }
+}
+
+// Add a new worm to the table.
+// The worm starts with its head only and grows to len_max elements.
+// Returns the id of the worm or -1 if the table is full.
+extern int addWorm(struct worm_table* atable, long len_max,
+                   struct pos headpos, enum WormHeading dir,
+                   enum ColorPairs color) {
+  int id = atable->nworms;
+  struct body_chunk* chunk;
+
+  if (id == atable->capacity || len_max < 1) {
+    return -1;
+  }
+  chunk = allocChunk(&atable->pool);
+  if (chunk == NULL) {
+    return -1;
+  }
+  atable->nworms++;
+  // The body consists of the head only
+  atable->tail_chunk[id] = chunk;
+  atable->head_chunk[id] = chunk;
+  atable->tail_off[id] = 0;
+  atable->head_off[id] = -1;
+  atable->length[id] = 0;
+  atable->max_length[id] = len_max;
+  pushHead(atable, id, headpos);
+  // Initialize the heading of the worm
+  setWormHeading(atable, id, dir);
+  // Initialize color and state of the worm
+  atable->wcolor[id] = color;
+  atable->state[id] = WORM_GAME_ONGOING;
+  atable->on_board[id] = false;
+
+  return id;
+}
+
+// Let worm id grow by amount elements.
+// The worm keeps its tail until it has reached its new length.
+extern void growWorm(struct worm_table* atable, int id, long amount) {
+  atable->max_length[id] += amount;
+}
+
+// Show the worms's elements on the board
 // Simple version
-extern void showWorm() {
-  int index = (theworm_headindex - 1);
-  int i;
+extern void showWorm(struct board* aboard, struct worm_table* atable, int id) {
   // Due to our encoding we just need to show the head element
+  // and turn the former head into an inner element.
   // All other elements are already displayed
-  placeItem(theworm_wormpos_y[theworm_headindex],
-            theworm_wormpos_x[theworm_headindex], SYMBOL_WORM_HEAD,
-            theworm_wcolor); //@007
-  if (index == -1) {
-    index = theworm_maxindex;
-  }
-  placeItem(theworm_wormpos_y[index], theworm_wormpos_x[index],
-            SYMBOL_WORM_INNER_ELEMENT,
-            theworm_wcolor); //??? differentiates between Head and inner element
-  for (i = theworm_headindex;
-       i == ((theworm_headindex + 1) % (theworm_maxindex + 1)); i--) {
-  }
-}
-extern void cleanWormTail() {
-  int tailindex; //  @006
-  // Compute tailindex
-  tailindex = (theworm_headindex + 1) %
-              (theworm_maxindex +
-               1); //
-                   // Check the array of worm elements.
-                   // Is the array element at tailindex already in use?
-                   // Checking either array theworm_wormpos_y
-                   // or theworm_wormpos_x is enough.
-  if (theworm_wormpos_x[tailindex] != UNUSED_POS_ELEM) {
-    // YES: place a SYMBOL_FREE_CELL at the tail's position
-    placeItem(theworm_wormpos_y[tailindex], theworm_wormpos_x[tailindex],
-              SYMBOL_FREE_CELL, COLP_FREE_CELL);
-  }
-}
-// The following functions all depend on the model of the worm
-
-extern void moveWorm(enum GameStates *agame_state) {
-  int headpos_x;
-  int headpos_y; //@010
-                 // Get the current position of the worm's head element and
-                 // compute the new head position according to current heading.
-                 // Do not store the new head position in the array of
-                 // positions, yet.
-  headpos_x = theworm_wormpos_x[theworm_headindex] + theworm_dx; //@011
-  headpos_y = theworm_wormpos_y[theworm_headindex] +
-              theworm_dy; //@012
-                          // Check if we would hit something (for good or bad)
-                          // or are going to leave the display if we move the
-                          // worm's head according to worm's last direction. We
-                          // are not allowed to leave the display's window.
-
-  if (headpos_x < 0) {
-    *agame_state = WORM_OUT_OF_BOUNDS;
-  } else if (headpos_x > getLastCol()) {
-    *agame_state = WORM_OUT_OF_BOUNDS;
-  } else if (headpos_y < 0) {
-    *agame_state = WORM_OUT_OF_BOUNDS;
-  } else if (headpos_y > getLastRow()) {
-    *agame_state = WORM_OUT_OF_BOUNDS;
-  } else {
-    // We will stay within bounds.
-    // Check if the worm's head will collide with itself at the new position
-    if (isInUseByWorm(headpos_y, headpos_x)) {
-      // That's bad: stop game
-      *agame_state = WORM_CROSSING;
-    }
-  }
-  // Check the status of *agame_state
-  // Go on if nothing bad happened
-  if (*agame_state == WORM_GAME_ONGOING) {
-    // So all is well: we did not hit anything bad and did not leave the
-    // window. --> Update the worm structure.
-    // Increment theworm_headindex
-    // Go round if end of worm is reached (ring buffer)
-    theworm_headindex = (theworm_headindex + 1) % (theworm_maxindex + 1);
-    // Store new coordinates of head element in worm structure
-    theworm_wormpos_x[theworm_headindex] = headpos_x;
-    theworm_wormpos_y[theworm_headindex] = headpos_y;
-  }
-}
-
-// A simple collision detection
-extern bool isInUseByWorm(int new_headpos_y, int new_headpos_x) {
-  int i;
-  bool collision = false;
-  i = theworm_headindex;
-  do {
-    // Compare the position of the current worm element with the new_headpos
-    if (theworm_wormpos_x[i] == new_headpos_x) {
-      if (theworm_wormpos_y[i] == new_headpos_y) {
-        collision = true;
-        break;
+  placeItem(aboard, atable->headpos[id].y, atable->headpos[id].x,
+            BC_USED_BY_WORM, SYMBOL_WORM_HEAD, atable->wcolor[id]);
+  if (atable->length[id] > 1) {
+    placeItem(aboard, atable->neckpos[id].y, atable->neckpos[id].x,
+              BC_USED_BY_WORM, SYMBOL_WORM_INNER_ELEMENT, atable->wcolor[id]);
+  }
+  atable->on_board[id] = true;
+}
+
+// Show all living worms at their new positions
+extern void showWorms(struct board* aboard, struct worm_table* atable) {
+  int id;
+  for (id = 0; id < atable->nworms; id++) {
+    if (atable->state[id] == WORM_GAME_ONGOING) {
+      showWorm(aboard, atable, id);
+    }
+  }
+}
+
+// Remove all elements of a dead worm from the board and give its
+// chunks back to the pool
+static void eraseWorm(struct board* aboard, struct worm_table* atable,
+                      int id) {
+  while (atable->length[id] > 0) {
+    struct pos tailpos =
+        atable->tail_chunk[id]->elems[atable->tail_off[id]];
+    placeItem(aboard, tailpos.y, tailpos.x, BC_FREE_CELL, SYMBOL_FREE_CELL,
+              COLP_FREE_CELL);
+    popTail(atable, id);
+  }
+  // Only the head chunk is left
+  releaseChunk(&atable->pool, atable->head_chunk[id]);
+  atable->tail_chunk[id] = atable->head_chunk[id] = NULL;
+  atable->on_board[id] = false;
+}
+
+// Free the tail cells of all living worms that are fully grown.
+// Worms that died during the last tick are removed from the board now;
+// thus the reason of death stays visible for one tick.
+extern void cleanWormTails(struct board* aboard, struct worm_table* atable) {
+  int id;
+
+  for (id = 0; id < atable->nworms; id++) {
+    if (atable->state[id] != WORM_GAME_ONGOING) {
+      if (atable->on_board[id]) {
+        eraseWorm(aboard, atable, id);
       }
+      continue;
+    }
+    // A growing worm keeps its tail
+    if (atable->length[id] >= atable->max_length[id]) {
+      struct pos tailpos =
+          atable->tail_chunk[id]->elems[atable->tail_off[id]];
+      // Place a SYMBOL_FREE_CELL at the tail's position.
+      // This also frees the cell on the board.
+      placeItem(aboard, tailpos.y, tailpos.x, BC_FREE_CELL, SYMBOL_FREE_CELL,
+                COLP_FREE_CELL);
+      popTail(atable, id);
+    }
+  }
+}
+
+// Move all living worms one step.
+// Worms move in the order of their ids. A head claims its new cell on the
+// board at once, so a worm entering the same cell later in the same tick
+// collides with it.
+extern void moveWorms(struct board* aboard, struct worm_table* atable) {
+  proposeMoves(aboard, atable, 0, atable->nworms);
+  resolveMoves(aboard, atable);
+}
+
+// First phase of moveWorms for the worms begin..end-1:
+// compute the new head positions and check them against the board.
+// Only reads the board and writes the slots of these worms; thus
+// disjoint ranges may be processed by different threads at the same time.
+extern void proposeMoves(struct board* aboard, struct worm_table* atable,
+                         int begin, int end) {
+  int last_row = getLastRow(aboard);
+  int last_col = getLastCol(aboard);
+  int id;
+
+  for (id = begin; id < end; id++) {
+    struct pos headpos;
+
+    if (atable->state[id] != WORM_GAME_ONGOING) {
+      continue;
     }
-    i = (i + theworm_maxindex) % (theworm_maxindex + 1);
-  } while (i != theworm_headindex && theworm_wormpos_x[i] != UNUSED_POS_ELEM);
-  // Return what we found out.
-  return collision;
+    // Compute the new head position according to current heading.
+    headpos.x = atable->headpos[id].x + atable->dx[id];
+    headpos.y = atable->headpos[id].y + atable->dy[id];
+    atable->nextpos[id] = headpos;
+
+    // We are not allowed to leave the board
+    if (headpos.x < 0 || headpos.x > last_col || headpos.y < 0 ||
+        headpos.y > last_row) {
+      atable->state[id] = WORM_OUT_OF_BOUNDS;
+    } else if (isInUseByWorm(aboard, headpos)) {
+      // The worm's head would collide with a worm
+      atable->state[id] = WORM_CROSSING;
+    }
+  }
+}
+
+// Second phase of moveWorms: settle conflicts in the order of the ids.
+// All cells occupied before this tick have been ruled out by proposeMoves;
+// a cell in use now has been claimed by a worm with a smaller id.
+extern void resolveMoves(struct board* aboard, struct worm_table* atable) {
+  int id;
+
+  for (id = 0; id < atable->nworms; id++) {
+    struct pos headpos = atable->nextpos[id];
+
+    if (atable->state[id] != WORM_GAME_ONGOING) {
+      continue;
+    }
+    if (isInUseByWorm(aboard, headpos)) {
+      atable->state[id] = WORM_CROSSING;
+      continue;
+    }
+    // So all is well --> Update the worm and claim the cell.
+    // The old head becomes the neck.
+    atable->neckpos[id] = atable->headpos[id];
+    if (!pushHead(atable, id, headpos)) {
+      atable->state[id] = WORM_OUT_OF_MEMORY;
+      continue;
+    }
+    setContentAt(aboard, headpos.y, headpos.x, BC_USED_BY_WORM);
+  }
+}
+
+// A simple collision detection.
+// The board knows the occupation of every cell; thus a single lookup
+// is enough regardless of the length and number of worms.
+// Note: tail cells have already been freed by cleanWormTails.
+extern bool isInUseByWorm(struct board* aboard, struct pos new_headpos) {
+  return getContentAt(aboard, new_headpos.y, new_headpos.x) ==
+         BC_USED_BY_WORM;
 }
+
 // Setters
-extern void setWormHeading(enum WormHeading dir) {
+extern void setWormHeading(struct worm_table* atable, int id,
+                           enum WormHeading dir) {
   switch (dir) {
-  case WORM_UP: // User wants up, @005
-    theworm_dx = 0;
-    theworm_dy = -1;
+  case WORM_UP: // User wants up
+    atable->dx[id] = 0;
+    atable->dy[id] = -1;
     break;
   case WORM_DOWN: // User wants down
-    theworm_dx = 0;
-    theworm_dy = 1;
+    atable->dx[id] = 0;
+    atable->dy[id] = 1;
     break;
   case WORM_LEFT: // User wants left
-    theworm_dx = -1;
-    theworm_dy = 0;
+    atable->dx[id] = -1;
+    atable->dy[id] = 0;
     break;
   case WORM_RIGHT: // User wants right
-    theworm_dx = 1;
-    theworm_dy = 0;
+    atable->dx[id] = 1;
+    atable->dy[id] = 0;
+    break;
+  }
+  atable->heading[id] = dir;
+}
+
+// End the game of worm id, e.g. because its player has left.
+// Its body is removed from the board by the next cleanWormTails.
+extern void setWormState(struct worm_table* atable, int id,
+                         enum GameStates state) {
+  atable->state[id] = state;
+}
+
+// Would heading dir lead the head straight back onto the worm's neck?
+extern bool isWormReversal(struct worm_table* atable, int id,
+                           enum WormHeading dir) {
+  struct pos neckpos = atable->neckpos[id];
+  struct pos newpos;
+
+  if (atable->length[id] < 2) {
+    return false; // A worm of length one may turn around
+  }
+  newpos = getNeighbourPos(atable->headpos[id], dir);
+  return newpos.y == neckpos.y && newpos.x == neckpos.x;
+}
+
+// The position next to pos in direction dir
+extern struct pos getNeighbourPos(struct pos pos, enum WormHeading dir) {
+  switch (dir) {
+  case WORM_UP:
+    pos.y--;
+    break;
+  case WORM_DOWN:
+    pos.y++;
+    break;
+  case WORM_LEFT:
+    pos.x--;
     break;
+  case WORM_RIGHT:
+    pos.x++;
+    break;
+  }
+  return pos;
+}
+
+// Getters
+extern struct pos getWormHeadPos(struct worm_table* atable, int id) {
+  // Structures are passed by value!
+  // -> we return a copy here
+  return atable->headpos[id];
+}
+
+// Position of the last element; the worm must have a body
+extern struct pos getWormTailPos(struct worm_table* atable, int id) {
+  return atable->tail_chunk[id]->elems[atable->tail_off[id]];
+}
+
+extern enum WormHeading getWormHeading(struct worm_table* atable, int id) {
+  return atable->heading[id];
+}
+
+extern enum GameStates getWormState(struct worm_table* atable, int id) {
+  return atable->state[id];
+}
+
+extern long getWormLength(struct worm_table* atable, int id) {
+  return atable->length[id];
+}
+
+// ************************************
+// Saving and loading
+// ************************************
+
+static void savePos(struct state_buffer* abuf, struct pos pos) {
+  putUint32(abuf, (uint32_t)pos.y);
+  putUint32(abuf, (uint32_t)pos.x);
+}
+
+static struct pos loadPos(struct state_buffer* abuf) {
+  struct pos pos;
+  pos.y = (int32_t)getUint32(abuf);
+  pos.x = (int32_t)getUint32(abuf);
+  return pos;
+}
+
+// Append all worms to abuf. A body is saved from the tail to the head.
+void saveWormTable(struct worm_table* atable, struct state_buffer* abuf) {
+  int id;
+
+  putUint32(abuf, atable->nworms);
+  for (id = 0; id < atable->nworms; id++) {
+    struct body_chunk* chunk = atable->tail_chunk[id];
+    int off = atable->tail_off[id];
+    long i;
+
+    putUint8(abuf, atable->heading[id]);
+    putUint8(abuf, atable->state[id]);
+    putUint8(abuf, atable->on_board[id]);
+    putUint8(abuf, atable->wcolor[id]);
+    putUint64(abuf, (uint64_t)atable->max_length[id]);
+    savePos(abuf, atable->headpos[id]);
+    savePos(abuf, atable->neckpos[id]);
+    // A worm erased from the board has no chunks at all
+    putUint8(abuf, chunk != NULL);
+    putUint64(abuf, (uint64_t)atable->length[id]);
+    for (i = 0; i < atable->length[id]; i++) {
+      savePos(abuf, chunk->elems[off]);
+      if (++off == CHUNK_LENGTH) {
+        chunk = chunk->next;
+        off = 0;
+      }
+    }
   }
 }
+
+// Give the chunks of all worms back to the pool
+static void releaseBodies(struct worm_table* atable) {
+  int id;
+
+  for (id = 0; id < atable->nworms; id++) {
+    struct body_chunk* chunk = atable->tail_chunk[id];
+    while (chunk != NULL) {
+      struct body_chunk* next =
+          chunk == atable->head_chunk[id] ? NULL : chunk->next;
+      releaseChunk(&atable->pool, chunk);
+      chunk = next;
+    }
+    atable->tail_chunk[id] = atable->head_chunk[id] = NULL;
+    atable->length[id] = 0;
+  }
+}
+
+// Replace all worms by those saved in abuf.
+// The bodies are rebuilt in chunks of our own pool. All positions must lie
+// on aboard and no worm may be longer than the board has cells.
+enum ResCodes loadWormTable(struct board* aboard, struct worm_table* atable,
+                            struct state_buffer* abuf) {
+  long ncells = (long)(getLastRow(aboard) + 1) * (getLastCol(aboard) + 1);
+  uint32_t nworms = getUint32(abuf);
+  int id;
+
+  if (nworms > (uint32_t)atable->capacity) {
+    return RES_FAILED;
+  }
+  releaseBodies(atable);
+  atable->nworms = (int)nworms;
+  for (id = 0; id < atable->nworms; id++) {
+    uint8_t heading, state;
+    bool has_chunks;
+    uint64_t length;
+    long i;
+
+    atable->tail_chunk[id] = atable->head_chunk[id] = NULL;
+    atable->length[id] = 0;
+    heading = getUint8(abuf);
+    state = getUint8(abuf);
+    atable->on_board[id] = getUint8(abuf) != 0;
+    atable->wcolor[id] = (enum ColorPairs)getUint8(abuf);
+    atable->max_length[id] = (long)getUint64(abuf);
+    atable->headpos[id] = loadPos(abuf);
+    atable->neckpos[id] = loadPos(abuf);
+    has_chunks = getUint8(abuf) != 0;
+    length = getUint64(abuf);
+    // The data may come from a torn file: everything must fit the board.
+    // A living worm has a body; the neck is only defined once it moved.
+    if (abuf->failed || heading > WORM_RIGHT || state > WORM_OUT_OF_MEMORY ||
+        atable->max_length[id] < 1 || length > (uint64_t)ncells ||
+        (!has_chunks && (length != 0 || atable->on_board[id])) ||
+        (state == WORM_GAME_ONGOING && length == 0) ||
+        !isInsideBoard(aboard, atable->headpos[id].y, atable->headpos[id].x) ||
+        (length > 1 &&
+         !isInsideBoard(aboard, atable->neckpos[id].y, atable->neckpos[id].x))) {
+      atable->nworms = id; // The bodies of these worms are complete
+      return RES_FAILED;
+    }
+    setWormHeading(atable, id, (enum WormHeading)heading);
+    atable->state[id] = (enum GameStates)state;
+    if (!has_chunks) {
+      continue;
+    }
+    atable->tail_chunk[id] = atable->head_chunk[id] = allocChunk(&atable->pool);
+    if (atable->tail_chunk[id] == NULL) {
+      atable->nworms = id;
+      return RES_FAILED;
+    }
+    atable->tail_off[id] = 0;
+    atable->head_off[id] = -1;
+    for (i = 0; i < (long)length; i++) {
+      struct pos pos = loadPos(abuf);
+      if (abuf->failed || !isInsideBoard(aboard, pos.y, pos.x) ||
+          !pushHead(atable, id, pos)) {
+        atable->nworms = id + 1;
+        return RES_FAILED;
+      }
+    }
+  }
+  return RES_OK;
+}
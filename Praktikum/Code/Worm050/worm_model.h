@@ -13,13 +13,80 @@
 #define _WORM_MODEL_H
 #include <stdbool.h>
 #include "worm.h"
+#include "board_model.h"
+#include "chunk_pool.h"
+#include "state_buffer.h"
 enum WormHeading {WORM_UP, WORM_DOWN, WORM_LEFT, WORM_RIGHT, };
 
-extern enum ResCodes initializeWorm(int len_max, int headpos_y, int headpos_x, enum WormHeading dir, enum ColorPairs color);
-extern void showWorm();
-extern void cleanWormTail();
-extern void moveWorm(enum GameStates *agame_state);
-extern bool isInUseByWorm(int new_headpos_y, int new_headpos_x);
-extern void setWormHeading(enum WormHeading dir);
+// All worms of a game in a table.
+// A worm is identified by its index (id) into the table.
+// Each component is stored in an array of its own (structure of arrays):
+// the batch operations below touch all heads or all headings in one
+// contiguous sweep instead of jumping from worm to worm.
+struct worm_table {
+  int nworms;   // Number of worms in use
+  int capacity; // Maximal number of worms
+
+  struct pos* headpos;       // Position of each head
+  int* dx;                   // Offset in x-direction per step
+  int* dy;                   // Offset in y-direction per step
+  enum WormHeading* heading; // Current heading (redundant to dx, dy)
+  enum GameStates* state;    // WORM_GAME_ONGOING or the reason of death
+  bool* on_board;            // Is the body still shown on the board?
+  enum ColorPairs* wcolor;   // Color of each worm
+  struct pos* nextpos;       // Head position proposed for the current tick
+
+  // Bodies: a chain of chunks from the tail to the head of each worm
+  struct body_chunk** tail_chunk; // Chunk holding the tail
+  int* tail_off;                  // Index of the tail in its chunk
+  struct body_chunk** head_chunk; // Chunk holding the head
+  int* head_off;                  // Index of the head in its chunk
+  long* length;                   // Current number of elements
+  long* max_length;               // Number of elements when fully grown
+  struct pos* neckpos;            // Element behind the head if length > 1
+  struct chunk_pool pool;         // The chunks of all bodies
+};
+
+// The table itself
+extern enum ResCodes initializeWormTable(struct worm_table* atable,
+                                         int capacity);
+extern void cleanupWormTable(struct worm_table* atable);
+extern int addWorm(struct worm_table* atable, long len_max,
+                   struct pos headpos, enum WormHeading dir,
+                   enum ColorPairs color);
+extern void growWorm(struct worm_table* atable, int id, long amount);
+
+// Batch operations over all living worms
+extern void cleanWormTails(struct board* aboard, struct worm_table* atable);
+extern void moveWorms(struct board* aboard, struct worm_table* atable);
+extern void proposeMoves(struct board* aboard, struct worm_table* atable,
+                         int begin, int end);
+extern void resolveMoves(struct board* aboard, struct worm_table* atable);
+extern void showWorms(struct board* aboard, struct worm_table* atable);
+
+// Single worms
+extern void showWorm(struct board* aboard, struct worm_table* atable, int id);
+extern bool isInUseByWorm(struct board* aboard, struct pos new_headpos);
+extern void setWormHeading(struct worm_table* atable, int id,
+                           enum WormHeading dir);
+extern void setWormState(struct worm_table* atable, int id,
+                         enum GameStates state);
+extern bool isWormReversal(struct worm_table* atable, int id,
+                           enum WormHeading dir);
+extern struct pos getNeighbourPos(struct pos pos, enum WormHeading dir);
+
+// Getters
+extern struct pos getWormHeadPos(struct worm_table* atable, int id);
+extern struct pos getWormTailPos(struct worm_table* atable, int id);
+extern enum WormHeading getWormHeading(struct worm_table* atable, int id);
+extern enum GameStates getWormState(struct worm_table* atable, int id);
+extern long getWormLength(struct worm_table* atable, int id);
+
+// Saving and loading all worms including their bodies
+extern void saveWormTable(struct worm_table* atable,
+                          struct state_buffer* abuf);
+extern enum ResCodes loadWormTable(struct board* aboard,
+                                   struct worm_table* atable,
+                                   struct state_buffer* abuf);
 
 #endif  // #define _WORM_MODEL_H